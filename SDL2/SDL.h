@@ -0,0 +1,3 @@
+#pragma once
+#include <cstdint>
+typedef uint32_t Uint32; typedef int32_t Sint32; typedef uint64_t Uint64;
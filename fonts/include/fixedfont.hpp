@@ -0,0 +1,234 @@
+#pragma once
+#include <GL/glew.h>
+
+// Totals for everything drawn through TextQuads, read by the stress mode.
+class TextRenderStats
+{
+public:
+    unsigned long long glyphs;
+    unsigned long long drawCalls;
+    unsigned long long stateChanges; // state-setting gl calls made through TextState, matrices not included
+
+    void reset()
+    {
+        glyphs = drawCalls = stateChanges = 0;
+    }
+};
+
+inline TextRenderStats &textRenderStats()
+{
+    static TextRenderStats stats = {0, 0, 0};
+    return stats;
+}
+
+// The state-setting GL calls of the text paths, each counted where it is issued.
+class TextState
+{
+public:
+    static void enable(GLenum cap)
+    {
+        glEnable(cap);
+        counted();
+    }
+
+    static void disable(GLenum cap)
+    {
+        glDisable(cap);
+        counted();
+    }
+
+    static void bindTexture(GLuint texture)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        counted();
+    }
+
+    static void blendAlpha()
+    {
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        counted();
+    }
+
+    static void enableClientState(GLenum array)
+    {
+        glEnableClientState(array);
+        counted();
+    }
+
+    static void disableClientState(GLenum array)
+    {
+        glDisableClientState(array);
+        counted();
+    }
+
+    static void vertexPointer(const float *vertices)
+    {
+        glVertexPointer(2, GL_FLOAT, 0, vertices);
+        counted();
+    }
+
+    static void texCoordPointer(const float *texCoords)
+    {
+        glTexCoordPointer(2, GL_FLOAT, 0, texCoords);
+        counted();
+    }
+
+    static void bindFramebuffer(GLuint framebuffer)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        counted();
+    }
+
+    static void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        glViewport(x, y, width, height);
+        counted();
+    }
+
+    static void pushAttrib(GLbitfield mask)
+    {
+        glPushAttrib(mask);
+        counted();
+    }
+
+    static void popAttrib()
+    {
+        glPopAttrib();
+        counted();
+    }
+
+    static void clearColor(float r, float g, float b, float a)
+    {
+        glClearColor(r, g, b, a);
+        counted();
+    }
+
+private:
+    static void counted()
+    {
+        textRenderStats().stateChanges++;
+    }
+};
+
+// Glyphs laid out as quads: 4 corners per glyph, x,y and s,t for each corner.
+template <int MAX_GLYPHS>
+class TextQuads
+{
+public:
+    float vertices[MAX_GLYPHS * 8];
+    float texCoords[MAX_GLYPHS * 8];
+    int glyphs;
+    int width; // pixels
+
+    void render(GLuint texture, float posX, float posY) const
+    {
+        if (!glyphs)
+        {
+            return;
+        }
+
+        glPushMatrix();
+        glTranslatef(posX, posY, 0.0f);
+
+        TextState::enable(GL_TEXTURE_2D);
+        TextState::bindTexture(texture);
+        TextState::enable(GL_BLEND);
+        TextState::blendAlpha();
+
+        TextState::enableClientState(GL_VERTEX_ARRAY);
+        TextState::enableClientState(GL_TEXTURE_COORD_ARRAY);
+        TextState::vertexPointer(vertices);
+        TextState::texCoordPointer(texCoords);
+        glDrawArrays(GL_QUADS, 0, glyphs * 4);
+        TextState::disableClientState(GL_TEXTURE_COORD_ARRAY);
+        TextState::disableClientState(GL_VERTEX_ARRAY);
+
+        TextState::disable(GL_BLEND);
+        TextState::disable(GL_TEXTURE_2D);
+
+        glPopMatrix();
+
+        TextRenderStats &stats = textRenderStats();
+        stats.glyphs += glyphs;
+        stats.drawCalls++;
+    }
+};
+
+// deliberately not constexpr: reaching it while laying out a literal at compile time is an error
+inline void glyphOutsideFontRange()
+{
+}
+
+// Monospaced font whose metrics are known at compile time. Glyph FIRST..LAST sit left to
+// right, top to bottom, COLUMNS per row in one sheet texture.
+template <int GLYPH_W, int GLYPH_H, int FIRST = 32, int LAST = 126, int COLUMNS = 16>
+class FixedFont
+{
+public:
+    static_assert(GLYPH_W > 0 && GLYPH_H > 0, "glyphs need a size");
+    static_assert(FIRST <= LAST, "empty glyph range");
+
+    static constexpr int glyphW = GLYPH_W;
+    static constexpr int glyphH = GLYPH_H;
+    static constexpr int glyphCount = LAST - FIRST + 1;
+    static constexpr int rows = (glyphCount + COLUMNS - 1) / COLUMNS;
+    static constexpr int sheetW = COLUMNS * GLYPH_W;
+    static constexpr int sheetH = rows * GLYPH_H;
+
+    static constexpr bool contains(int c)
+    {
+        return c >= FIRST && c <= LAST;
+    }
+
+    static constexpr int textWidth(const char *str)
+    {
+        return *str ? GLYPH_W + textWidth(str + 1) : 0;
+    }
+
+    // For a string literal in a constexpr context this runs entirely at compile time and
+    // rejects characters outside FIRST..LAST. At runtime they are skipped instead.
+    template <int N>
+    static constexpr TextQuads<N> layout(const char (&str)[N])
+    {
+        TextQuads<N> quads{};
+        layoutInto(str, quads);
+        return quads;
+    }
+
+    template <int MAX_GLYPHS>
+    static constexpr void layoutInto(const char *str, TextQuads<MAX_GLYPHS> &quads)
+    {
+        quads.glyphs = 0;
+        quads.width = 0;
+
+        for (int posX = 0; *str != '\0' && quads.glyphs < MAX_GLYPHS; str++, posX += GLYPH_W)
+        {
+            int c = static_cast<unsigned char>(*str);
+            if (!contains(c))
+            {
+                glyphOutsideFontRange();
+                continue;
+            }
+
+            int index = c - FIRST;
+            float s0 = (float)(index % COLUMNS) / COLUMNS;
+            float s1 = (float)(index % COLUMNS + 1) / COLUMNS;
+            float t0 = (float)(index / COLUMNS) / rows; // top row of the glyph in the sheet
+            float t1 = (float)(index / COLUMNS + 1) / rows;
+
+            float corners[8] = {(float)posX, 0.0f,
+                                (float)(posX + GLYPH_W), 0.0f,
+                                (float)(posX + GLYPH_W), (float)GLYPH_H,
+                                (float)posX, (float)GLYPH_H};
+            float coords[8] = {s0, t1, s1, t1, s1, t0, s0, t0};
+
+            for (int i = 0; i < 8; i++)
+            {
+                quads.vertices[quads.glyphs * 8 + i] = corners[i];
+                quads.texCoords[quads.glyphs * 8 + i] = coords[i];
+            }
+            quads.glyphs++;
+            quads.width = posX + GLYPH_W;
+        }
+    }
+};
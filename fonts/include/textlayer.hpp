@@ -0,0 +1,33 @@
+#pragma once
+#include <GL/glew.h>
+
+// Text that rarely changes, rendered once into a texture and then drawn every frame as a
+// single quad. Whoever owns the layer calls invalidate() when the text on it changes.
+class TextLayer
+{
+public:
+    int width, height;
+    GLuint framebuffer;
+    GLuint texture;
+    bool isCached; // 0 when framebuffer objects are missing, the text is then drawn directly
+    bool isDirty;
+    int updates; // times the contents were rendered into the texture
+
+    TextLayer();
+
+    bool create(int width, int height);
+
+    void invalidate();
+
+    void beginUpdate();
+
+    void endUpdate();
+
+    void draw(float posX, float posY);
+
+    void destroy();
+
+private:
+    GLint previousFramebuffer;
+    GLint previousViewport[4];
+};
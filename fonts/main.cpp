@@ -1,40 +1,73 @@
 #include <iostream>
+#include <vector>
+#include <algorithm>
 #include <GL/glew.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
+#include "include/offscreen.hpp"
+#include "include/fixedfont.hpp"
+#include "include/textlayer.hpp"
 
 const int SCREEN_WIDTH = 320;
 const int SCREEN_HEIGHT = 240;
 
+/* 12x16 in 192x96 png with white ascii letters on black color as transparent
+   https://opengameart.org/content/16x12-terminal-bitmap-font */
+typedef FixedFont<12, 16, ' ', '~'> PixFont;
+
+// laid out at compile time, drawing one is a single glDrawArrays
+static constexpr auto titleLabel = PixFont::layout("T35T1N9");
+static constexpr auto renderingLabel = PixFont::layout("Rendering text in OpenGL");
+static constexpr auto symbolsLabel = PixFont::layout("123 @#$ asdf ASDF ?!*&%");
+static constexpr auto helloLabel = PixFont::layout("Hello World! :-)");
+static constexpr auto scoreLabel = PixFont::layout("Score: ");
+
 class FontApp
 {
 public:
-    bool isRunning;
+    bool isRunning, isOffscreen;
     SDL_Window *window;
     SDL_GLContext context;
-    GLuint fontTextures[95]; // ASCII printable characters as textures
+    GLuint fontTexture; // the whole PixFont sheet
+    TextQuads<64> textQuads; // scratch for text only known at runtime
+
+    // everything on screen, rendered into a texture only when the score changes
+    TextLayer staticText;
+    int score;
+    char scoreText[12];
+
+    // the text is static, so after the first frame it is only redrawn when the window asks for it
+    static const int IDLE_WAIT_MS = 500;
+    bool redrawRequested;
 
     FontApp()
     {
         isRunning = 0;
+        isOffscreen = 0;
+        redrawRequested = 1;
         window = nullptr;
         context = nullptr;
+        fontTexture = 0;
+
+        score = -1;
+        setScore(21);
     }
 
-    void run()
+    bool init(bool hidden)
     {
         if (SDL_Init(SDL_INIT_VIDEO) < 0)
         {
             std::cout << "SDL init problem" << std::endl;
-            return;
+            return 0;
         }
 
-        window = SDL_CreateWindow("OpenGl text demo", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
+        Uint32 windowFlags = SDL_WINDOW_OPENGL | (hidden ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN);
+        window = SDL_CreateWindow("OpenGl text demo", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, windowFlags);
         if (!window)
         {
             std::cout << "SDL window create problem" << std::endl;
             SDL_Quit();
-            return;
+            return 0;
         }
 
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
@@ -46,92 +79,252 @@ public:
             std::cout << "OpenGL context create problem" << std::endl;
             SDL_DestroyWindow(window);
             SDL_Quit();
-            return;
+            return 0;
+        }
+
+        if (glewInit() != GLEW_OK)
+        {
+            std::cout << "GLEW init problem" << std::endl;
+            return 0;
+        }
+
+        fontTexture = createFontTextureFromPng("pixfont.png");
+        if (!fontTexture)
+        {
+            return 0;
         }
 
-        /* 12x16 in 192x96 png with white ascii letters on black color as transparent
-           https://opengameart.org/content/16x12-terminal-bitmap-font */
-        createPrintableAsciiCharsTexturesFromPng("pixfont.png", 12, 16, 192, 96);
+        // without framebuffer objects Render simply draws the text directly
+        staticText.create(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+        return 1;
+    }
+
+    void run()
+    {
+        if (!init(0))
+        {
+            return;
+        }
 
         isRunning = 1;
         while (isRunning)
         {
-            WaitFrame(60);
+            if (redrawRequested)
+            {
+                WaitFrame(60);
+            }
+            else
+            {
+                // block in the event queue instead of redrawing the same frame 60 times a second
+                SDL_WaitEventTimeout(nullptr, IDLE_WAIT_MS);
+            }
+
             ProcessEvents();
             Update();
-            Render();
+
+            if (redrawRequested)
+            {
+                Render();
+                redrawRequested = 0;
+            }
         }
     }
 
-    GLuint createTextureFromSurface(SDL_Surface *surface)
+    void runOffscreen(int frames, const std::vector<int> &dumpFrames)
     {
-        GLuint textureID;
-        glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, surface->w, surface->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        return textureID;
+        if (!init(1))
+        {
+            return;
+        }
+
+        OffscreenTarget target;
+        if (!target.create(SCREEN_WIDTH, SCREEN_HEIGHT))
+        {
+            return;
+        }
+
+        isOffscreen = 1;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            SDL_PumpEvents();
+            Update();
+
+            target.beginFrame();
+            Render();
+            target.endFrame();
+
+            if (std::find(dumpFrames.begin(), dumpFrames.end(), frame) != dumpFrames.end())
+            {
+                char filename[64];
+                snprintf(filename, sizeof(filename), "fonts_%05d.ppm", frame);
+                target.dumpPpm(filename);
+            }
+        }
+
+        target.finish();
+        target.report("FontApp");
+        std::cout << "  text layer: " << (staticText.isCached ? "cached" : "not cached") << ", "
+                  << staticText.updates << " updates in " << frames << " frames" << std::endl;
+        target.destroy();
     }
 
-    void createPrintableAsciiCharsTexturesFromPng(const char *filename, int symW, int symH, int srcW, int srcH)
+    // Text throughput benchmark: every frame draws `strings` random strings at random places,
+    // with no frame pacing and no vsync. Offscreen when hidden, otherwise in the window.
+    void runStress(int strings, int frames, bool hidden)
     {
-        SDL_Surface *surface = IMG_Load(filename);
+        if (!init(hidden))
+        {
+            return;
+        }
 
-        int offX = 0;
-        int offY = 0;
+        OffscreenTarget target;
+        if (hidden)
+        {
+            if (!target.create(SCREEN_WIDTH, SCREEN_HEIGHT))
+            {
+                return;
+            }
+            isOffscreen = 1;
+        }
+        else
+        {
+            SDL_GL_SetSwapInterval(0);
+        }
 
-        SDL_Surface *newSurface;
-        newSurface = nullptr;
+        // the strings are made up front, so only laying them out and drawing them is measured
+        static const int POOL_SIZE = 256;
+        static const int MAX_LENGTH = 40;
+        std::vector<char> pool(POOL_SIZE * (MAX_LENGTH + 1));
+        srand(1);
+        for (int i = 0; i < POOL_SIZE; i++)
+        {
+            char *str = &pool[i * (MAX_LENGTH + 1)];
+            int length = 8 + rand() % (MAX_LENGTH - 7);
+            for (int c = 0; c < length; c++)
+            {
+                str[c] = ' ' + 1 + rand() % ('~' - ' ');
+            }
+            str[length] = '\0';
+        }
+
+        textRenderStats().reset();
+        Uint64 start = SDL_GetPerformanceCounter();
 
-        GLuint textureID = 0;
-        for (int i = 0; i < 95; ++i)
+        isRunning = 1;
+        int frame = 0;
+        for (; frame < frames && isRunning; frame++)
         {
-            newSurface = getPartOfSurfaceAsNewSurface(surface, symW, symH, offX, offY, srcW, srcH);
-            textureID = createTextureFromSurface(newSurface);
-            fontTextures[i] = textureID;
-            SDL_FreeSurface(newSurface);
+            if (hidden)
+            {
+                SDL_PumpEvents();
+                target.beginFrame();
+            }
+            else
+            {
+                ProcessEvents();
+            }
+
+            glMatrixMode(GL_PROJECTION);
+            glLoadIdentity();
+            glOrtho(0.0f, SCREEN_WIDTH, 0.0f, SCREEN_HEIGHT, -1.0f, 1.0f);
+            glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            glMatrixMode(GL_MODELVIEW);
+            glLoadIdentity();
+
+            for (int i = 0; i < strings; i++)
+            {
+                const char *str = &pool[(rand() % POOL_SIZE) * (MAX_LENGTH + 1)];
+                renderText(str, rand() % SCREEN_WIDTH - SCREEN_WIDTH / 2, rand() % SCREEN_HEIGHT);
+            }
 
-            offX += symW;
-            if (offX >= srcW)
+            if (hidden)
             {
-                offX = 0;
-                offY += symH;
+                target.endFrame();
+            }
+            else
+            {
+                SDL_GL_SwapWindow(window);
             }
         }
-        SDL_FreeSurface(surface);
+
+        // the GPU has to catch up before the clock stops, or queued frames would be free
+        glFinish();
+        double seconds = (SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+
+        TextRenderStats &stats = textRenderStats();
+        frame = std::max(frame, 1);
+        std::cout << "stress: " << strings << " strings per frame, " << frame << " frames in " << seconds << " s" << std::endl;
+        std::cout << "  glyphs/s " << stats.glyphs / seconds << ", frames/s " << frame / seconds << std::endl;
+        std::cout << "  per frame: glyphs " << stats.glyphs / frame << ", draw calls " << stats.drawCalls / frame
+                  << ", state changes " << stats.stateChanges / frame << std::endl;
+
+        if (hidden)
+        {
+            target.finish();
+            target.report("FontApp stress");
+            target.destroy();
+        }
     }
 
-    SDL_Surface *getPartOfSurfaceAsNewSurface(SDL_Surface *surface, int symW, int symH, int offX, int offY, int srcW, int srcH)
+    GLuint createTextureFromSurface(SDL_Surface *surface)
     {
-        SDL_Surface *newSurface = SDL_CreateRGBSurfaceWithFormat(0, symW, symH, 32, SDL_PIXELFORMAT_RGBA32);
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, surface->w, surface->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        // nearest, so neighbouring glyphs in the sheet never bleed in
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        return textureID;
+    }
 
-        Uint32 p32, *buf32;
-        Uint8 r, g, b, a;
+    GLuint createFontTextureFromPng(const char *filename)
+    {
+        SDL_Surface *loaded = IMG_Load(filename);
+        if (!loaded)
+        {
+            std::cout << "font sheet " << filename << " load problem" << std::endl;
+            return 0;
+        }
 
-        for (int y = 0; y < symH; y++)
+        SDL_Surface *surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(loaded);
+        if (!surface)
         {
-            for (int x = 0; x < symW; x++)
-            {
-                buf32 = (Uint32 *)surface->pixels;
-                p32 = buf32[(offY + y) * srcW + (offX + x)];
+            return 0;
+        }
 
-                SDL_GetRGBA(p32, surface->format, &r, &g, &b, &a);
+        if (surface->w != PixFont::sheetW || surface->h != PixFont::sheetH)
+        {
+            std::cout << "font sheet " << filename << " is " << surface->w << "x" << surface->h
+                      << ", expected " << PixFont::sheetW << "x" << PixFont::sheetH << std::endl;
+            SDL_FreeSurface(surface);
+            return 0;
+        }
 
+        // black is the transparent color
+        for (int y = 0; y < surface->h; y++)
+        {
+            Uint32 *row = (Uint32 *)((Uint8 *)surface->pixels + y * surface->pitch);
+            for (int x = 0; x < surface->w; x++)
+            {
+                Uint8 r, g, b, a;
+                SDL_GetRGBA(row[x], surface->format, &r, &g, &b, &a);
                 if (r == 0 && g == 0 && b == 0)
                 {
-                    a = 0;
+                    row[x] = SDL_MapRGBA(surface->format, 0, 0, 0, 0);
                 }
-
-                Uint8 *pixelPtr = static_cast<Uint8 *>(newSurface->pixels) + y * newSurface->pitch + x * newSurface->format->BytesPerPixel;
-                Uint32 *pixel = reinterpret_cast<Uint32 *>(pixelPtr);
-                *pixel = SDL_MapRGBA(newSurface->format, r, g, b, a);
             }
         }
 
-        return newSurface;
+        GLuint textureID = createTextureFromSurface(surface);
+        SDL_FreeSurface(surface);
+        return textureID;
     }
 
     void WaitFrame(int fps)
@@ -183,6 +376,13 @@ public:
                     break;
                 }
                 break;
+
+            case SDL_WINDOWEVENT:
+                if (event.window.event == SDL_WINDOWEVENT_EXPOSED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                {
+                    redrawRequested = 1;
+                }
+                break;
             default:
                 break;
             }
@@ -206,22 +406,52 @@ public:
         glMatrixMode(GL_MODELVIEW);
         glLoadIdentity();
 
-         renderText("T35T1N9", 100, 180);
+        if (staticText.isCached)
+        {
+            if (staticText.isDirty)
+            {
+                staticText.beginUpdate();
+                renderStaticText();
+                staticText.endUpdate();
+            }
+            staticText.draw(0, 0);
+        }
+        else
+        {
+            renderStaticText();
+        }
+
+        if (!isOffscreen)
+        {
+            SDL_GL_SwapWindow(window);
+        }
+    }
 
-        renderText("Rendering text in OpenGL", 10, 130);
-        renderText("123 @#$ asdf ASDF ?!*&%", 10, 100);
-        renderText("Hello World! :-)", 10, 70);
+    void renderStaticText()
+    {
+        titleLabel.render(fontTexture, 100, 180);
 
-        int someScore = 21;
-        char *myString = myIntToStr(someScore);
+        renderingLabel.render(fontTexture, 10, 130);
+        symbolsLabel.render(fontTexture, 10, 100);
+        helloLabel.render(fontTexture, 10, 70);
 
-        renderText("Score: ", 10, 40);
-        renderText(myString, 84, 40);
+        scoreLabel.render(fontTexture, 10, 40);
+        renderText(scoreText, 10 + scoreLabel.width, 40);
+    }
 
-        SDL_GL_SwapWindow(window);
+    void setScore(int value)
+    {
+        if (value != score)
+        {
+            score = value;
+            myIntToStr(score, scoreText);
+            staticText.invalidate();
+            redrawRequested = 1;
+        }
     }
 
-    char *myIntToStr(int num)
+    // str needs room for 11 characters and the terminator
+    char *myIntToStr(int num, char *str)
     {
         // not ideal but works
         int digts = 1;
@@ -230,7 +460,6 @@ public:
         {
             digts++;
         }
-        char *str = new char[digts + 1];
         for (int i = digts - 1; i >= 0; i--)
         {
             int digit = num % 10;
@@ -243,49 +472,15 @@ public:
 
     void renderText(const char *str, int posX, int posY)
     {
-        while (*str != '\0')
-        {
-            int asciiCode = static_cast<int>(*str);
-            renderTextureBlock(fontTextures[asciiCode - 32], posX, posY, 12, 16);
-            posX += 12;
-            ++str;
-        }
-    }
-
-    void renderTextureBlock(GLuint texture, float x, float y, float textureWidth, float textureHeight)
-    {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texture);
-
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        glBegin(GL_TRIANGLES);
-        glTexCoord2f(0, 1);
-        glVertex2f(x, y);
-
-        glTexCoord2f(1, 1);
-        glVertex2f(x + textureWidth, y);
-
-        glTexCoord2f(1, 0);
-        glVertex2f(x + textureWidth, y + textureHeight);
-
-        glTexCoord2f(1, 0);
-        glVertex2f(x + textureWidth, y + textureHeight);
-
-        glTexCoord2f(0, 0);
-        glVertex2f(x, y + textureHeight);
-
-        glTexCoord2f(0, 1);
-        glVertex2f(x, y);
-        glEnd();
-
-        glDisable(GL_BLEND);
-        glDisable(GL_TEXTURE_2D);
+        PixFont::layoutInto(str, textQuads);
+        textQuads.render(fontTexture, posX, posY);
     }
 
     ~FontApp()
     {
+        staticText.destroy();
+        if (fontTexture)
+            glDeleteTextures(1, &fontTexture);
         if (context)
             SDL_GL_DeleteContext(context);
         if (window)
@@ -294,9 +489,41 @@ public:
     }
 };
 
-int main()
+int main(int argc, char *argv[])
 {
+    int offscreenFrames = 0;
+    std::vector<int> dumpFrames;
+    int stressStrings = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--offscreen") && i + 1 < argc)
+        {
+            offscreenFrames = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--dump") && i + 1 < argc)
+        {
+            dumpFrames.push_back(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--stress") && i + 1 < argc)
+        {
+            stressStrings = atoi(argv[++i]);
+        }
+    }
+
     FontApp app;
-    app.run();
+    if (stressStrings > 0)
+    {
+        // with --offscreen N the stress run is headless and N frames long
+        app.runStress(stressStrings, offscreenFrames > 0 ? offscreenFrames : 600, offscreenFrames > 0);
+    }
+    else if (offscreenFrames > 0)
+    {
+        app.runOffscreen(offscreenFrames, dumpFrames);
+    }
+    else
+    {
+        app.run();
+    }
     return 0;
 }
\ No newline at end of file
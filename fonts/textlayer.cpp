@@ -0,0 +1,147 @@
+
+#include <iostream>
+#include "include/textlayer.hpp"
+#include "include/fixedfont.hpp"
+
+TextLayer::TextLayer()
+{
+    width = 0;
+    height = 0;
+    framebuffer = 0;
+    texture = 0;
+    isCached = 0;
+    isDirty = 1;
+    updates = 0;
+    previousFramebuffer = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        previousViewport[i] = 0;
+    }
+}
+
+bool TextLayer::create(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+    isDirty = 1;
+
+    if (!GLEW_ARB_framebuffer_object)
+    {
+        std::cout << "text layer: framebuffer objects not supported, drawing text every frame" << std::endl;
+        return 0;
+    }
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // drawn 1:1 onto the screen, nearest keeps the pixel font sharp
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    GLint bound = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &bound);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, bound);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "text layer: framebuffer incomplete, drawing text every frame" << std::endl;
+        destroy();
+        return 0;
+    }
+
+    isCached = 1;
+    return 1;
+}
+
+void TextLayer::invalidate()
+{
+    isDirty = 1;
+}
+
+void TextLayer::beginUpdate()
+{
+    // the screen may itself be a framebuffer object (offscreen runs), so remember what to go back to
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+    TextState::bindFramebuffer(framebuffer);
+    TextState::viewport(0, 0, width, height);
+
+    TextState::pushAttrib(GL_COLOR_BUFFER_BIT);
+    TextState::clearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    TextState::popAttrib();
+
+    // same pixel coordinates as the screen
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0.0f, width, 0.0f, height, -1.0f, 1.0f);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+}
+
+void TextLayer::endUpdate()
+{
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+
+    TextState::bindFramebuffer(previousFramebuffer);
+    TextState::viewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+
+    isDirty = 0;
+    updates++;
+}
+
+void TextLayer::draw(float posX, float posY)
+{
+    // glyphs are either fully opaque or fully transparent, so plain alpha blending of the
+    // layer gives exactly what drawing them directly would
+    TextState::enable(GL_TEXTURE_2D);
+    TextState::bindTexture(texture);
+    TextState::enable(GL_BLEND);
+    TextState::blendAlpha();
+
+    glBegin(GL_QUADS);
+    {
+        glTexCoord2f(0.0f, 0.0f);
+        glVertex2f(posX, posY);
+        glTexCoord2f(1.0f, 0.0f);
+        glVertex2f(posX + width, posY);
+        glTexCoord2f(1.0f, 1.0f);
+        glVertex2f(posX + width, posY + height);
+        glTexCoord2f(0.0f, 1.0f);
+        glVertex2f(posX, posY + height);
+    }
+    glEnd();
+
+    TextState::disable(GL_BLEND);
+    TextState::disable(GL_TEXTURE_2D);
+
+    textRenderStats().drawCalls++;
+}
+
+void TextLayer::destroy()
+{
+    if (framebuffer)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        framebuffer = 0;
+    }
+    if (texture)
+    {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+    isCached = 0;
+}
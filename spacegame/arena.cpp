@@ -0,0 +1,156 @@
+
+#include <new>
+#include <atomic>
+#include <stdlib.h>
+#include "include/arena.hpp"
+
+static std::atomic<Uint64> allocationsCount(0);
+static std::atomic<Uint64> freesCount(0);
+
+Uint64 heapAllocations()
+{
+    return allocationsCount.load();
+}
+
+Uint64 heapFrees()
+{
+    return freesCount.load();
+}
+
+Sint64 heapLiveAllocations()
+{
+    return (Sint64)(allocationsCount.load() - freesCount.load());
+}
+
+static void *countedAlloc(size_t size)
+{
+    void *memory = malloc(size ? size : 1);
+    if (memory)
+    {
+        allocationsCount++;
+    }
+    return memory;
+}
+
+static void countedFree(void *memory)
+{
+    if (memory)
+    {
+        freesCount++;
+        free(memory);
+    }
+}
+
+void *operator new(size_t size)
+{
+    void *memory = countedAlloc(size);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    countedFree(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    countedFree(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+    countedFree(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+    countedFree(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    countedFree(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+    countedFree(memory);
+}
+
+// ---------------------------------------------------------------------------
+
+FrameArena::FrameArena()
+{
+    buffer = nullptr;
+    capacity = 0;
+    used = 0;
+    highWater = 0;
+    overflows = 0;
+}
+
+bool FrameArena::create(int capacity)
+{
+    destroy();
+
+    // malloc, so the arena stays out of the new/delete counters
+    buffer = (char *)malloc(capacity);
+    if (!buffer)
+    {
+        return 0;
+    }
+    this->capacity = capacity;
+    return 1;
+}
+
+void *FrameArena::alloc(int size, int align)
+{
+    int start = (used + align - 1) & ~(align - 1);
+    if (!buffer || start + size > capacity)
+    {
+        overflows++;
+        return nullptr;
+    }
+    used = start + size;
+    return buffer + start;
+}
+
+void FrameArena::reset()
+{
+    if (used > highWater)
+    {
+        highWater = used;
+    }
+    used = 0;
+}
+
+void FrameArena::destroy()
+{
+    free(buffer);
+    buffer = nullptr;
+    capacity = 0;
+    used = 0;
+}
+
+FrameArena::~FrameArena()
+{
+    destroy();
+}
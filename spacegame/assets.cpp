@@ -0,0 +1,103 @@
+
+#include "include/assets.hpp"
+
+AssetLoader::AssetLoader()
+{
+    running = 0;
+    stopping = 0;
+}
+
+void AssetLoader::submit(std::function<void(AssetLoader &)> task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(task);
+
+    // the worker is started lazily so a game without async assets never spawns it
+    if (!worker.joinable())
+    {
+        worker = std::thread(&AssetLoader::workerLoop, this);
+    }
+    wakeUp.notify_one();
+}
+
+void AssetLoader::push(int kind, int index, SDL_Surface *surface)
+{
+    LoadedImage image;
+    image.kind = kind;
+    image.index = index;
+    image.surface = surface;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ready.push_back(image);
+}
+
+bool AssetLoader::pop(LoadedImage &image)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ready.empty())
+    {
+        return 0;
+    }
+    image = ready.front();
+    ready.pop_front();
+    return 1;
+}
+
+bool AssetLoader::isBusy()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return running || !tasks.empty() || !ready.empty();
+}
+
+void AssetLoader::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (1)
+    {
+        while (tasks.empty() && !stopping)
+        {
+            wakeUp.wait(lock);
+        }
+        if (stopping)
+        {
+            return;
+        }
+
+        std::function<void(AssetLoader &)> task = tasks.front();
+        tasks.pop_front();
+        running++;
+
+        lock.unlock();
+        task(*this);
+        lock.lock();
+
+        running--;
+    }
+}
+
+void AssetLoader::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = 1;
+        wakeUp.notify_one();
+    }
+
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+
+    // buffers nobody uploaded
+    for (size_t i = 0; i < ready.size(); i++)
+    {
+        SDL_FreeSurface(ready[i].surface);
+    }
+    ready.clear();
+    tasks.clear();
+}
+
+AssetLoader::~AssetLoader()
+{
+    stop();
+}
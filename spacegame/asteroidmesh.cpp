@@ -0,0 +1,153 @@
+
+#include <math.h>
+#include "include/asteroidmesh.hpp"
+#include "include/random.hpp"
+
+AsteroidMeshes::AsteroidMeshes()
+{
+    for (int i = 0; i < SHAPES; i++)
+    {
+        first[i] = 0;
+        count[i] = 0;
+    }
+    buffer = 0;
+    quadsCount = 0;
+}
+
+void AsteroidMeshes::generate(unsigned int seed)
+{
+    // its own generator, the looks of the rocks must not shift the gameplay random sequence
+    GameRandom random;
+    random.seed(seed);
+
+    vertices.clear();
+    quads.assign(MAX_QUADS * 8, 0.0f);
+    quadsCount = 0;
+
+    for (int sizeClass = 0; sizeClass < SIZE_CLASSES; sizeClass++)
+    {
+        float radius = 15.0f + 5.0f * sizeClass;
+        int points = 8 + 2 * sizeClass; // bigger rocks get more detail
+
+        for (int variant = 0; variant < VARIANTS; variant++)
+        {
+            int shape = sizeClass * VARIANTS + variant;
+            first[shape] = (int)vertices.size() / 2;
+
+            vertices.push_back(0.0f);
+            vertices.push_back(0.0f);
+
+            float firstX = 0, firstY = 0;
+            for (int i = 0; i < points; i++)
+            {
+                // jitter both angle and radius, the outline stays star shaped around the centre
+                float step = 2.0f * M_PI / points;
+                float angle = step * (i + 0.35f * ((random.next() % 100) / 100.0f - 0.5f));
+                float r = radius * (0.75f + 0.4f * (random.next() % 100) / 100.0f);
+                float x = r * cos(angle);
+                float y = r * sin(angle);
+                if (i == 0)
+                {
+                    firstX = x;
+                    firstY = y;
+                }
+                vertices.push_back(x);
+                vertices.push_back(y);
+            }
+            vertices.push_back(firstX);
+            vertices.push_back(firstY);
+
+            count[shape] = points + 2;
+        }
+    }
+}
+
+void AsteroidMeshes::upload()
+{
+    if (!GLEW_VERSION_1_5 || vertices.empty())
+    {
+        return;
+    }
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+int AsteroidMeshes::shapeFor(float size, int variant)
+{
+    int sizeClass = (int)((size - 15.0f) / 5.0f + 0.5f);
+    sizeClass = sizeClass < 0 ? 0 : (sizeClass >= SIZE_CLASSES ? SIZE_CLASSES - 1 : sizeClass);
+    return sizeClass * VARIANTS + variant % VARIANTS;
+}
+
+void AsteroidMeshes::beginBatch()
+{
+    glEnableClientState(GL_VERTEX_ARRAY);
+    if (buffer)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glVertexPointer(2, GL_FLOAT, 0, nullptr);
+    }
+    else
+    {
+        glVertexPointer(2, GL_FLOAT, 0, vertices.data());
+    }
+}
+
+void AsteroidMeshes::draw(int shape, float posX, float posY, float angle)
+{
+    glPushMatrix();
+    glTranslatef(posX, posY, 0.0f);
+    glRotatef(angle, 0.0f, 0.0f, 1.0f);
+    glDrawArrays(GL_TRIANGLE_FAN, first[shape], count[shape]);
+    glPopMatrix();
+}
+
+void AsteroidMeshes::endBatch()
+{
+    if (buffer)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void AsteroidMeshes::addQuad(float posX, float posY, float size)
+{
+    if (quadsCount >= MAX_QUADS)
+    {
+        return;
+    }
+
+    float corners[8] = {posX - size, posY - size, posX + size, posY - size,
+                        posX + size, posY + size, posX - size, posY + size};
+    for (int i = 0; i < 8; i++)
+    {
+        quads[quadsCount * 8 + i] = corners[i];
+    }
+    quadsCount++;
+}
+
+void AsteroidMeshes::drawQuads()
+{
+    // no per asteroid transform or draw call, the corners are already in world units
+    if (quadsCount)
+    {
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(2, GL_FLOAT, 0, quads.data());
+        glDrawArrays(GL_QUADS, 0, quadsCount * 4);
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+    quadsCount = 0;
+}
+
+void AsteroidMeshes::destroy()
+{
+    if (buffer)
+    {
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+}
@@ -0,0 +1,341 @@
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include "include/capture.hpp"
+
+FrameCapture::FrameCapture()
+{
+    width = 0;
+    height = 0;
+    frameBytes = 0;
+    isActive = 0;
+    hasPixelBuffers = 0;
+    for (int i = 0; i < PBO_RING; i++)
+    {
+        pixelBuffers[i] = 0;
+    }
+    framesRead = 0;
+    framesMapped = 0;
+    framesDropped = 0;
+    framesWritten = 0;
+    captureMsTotal = 0;
+    captureMsMax = 0;
+    framesCaptured = 0;
+    framesOverBudget = 0;
+    path = nullptr;
+    isSequence = 0;
+    rawFile = nullptr;
+    slots = nullptr;
+    rowBuffer = nullptr;
+    for (int i = 0; i < WRITE_SLOTS; i++)
+    {
+        slotFrames[i] = 0;
+    }
+    slotsQueued = 0;
+    slotsWritten = 0;
+    stopping = 0;
+}
+
+bool FrameCapture::create(const char *path, int width, int height)
+{
+    this->path = path;
+    this->width = width;
+    this->height = height;
+    frameBytes = width * height * 4;
+
+    isSequence = strchr(path, '%') != nullptr;
+    if (isSequence && !isFramePattern(path))
+    {
+        std::cout << "capture: cannot write " << path << ", it needs one frame number like %05d" << std::endl;
+        return 0;
+    }
+    if (!isSequence)
+    {
+        rawFile = fopen(path, "wb");
+        if (!rawFile)
+        {
+            std::cout << "capture: cannot write " << path << std::endl;
+            return 0;
+        }
+    }
+
+    // everything the capture needs is allocated here, recording never touches the heap
+    slots = (unsigned char *)malloc((size_t)frameBytes * WRITE_SLOTS);
+    rowBuffer = (unsigned char *)malloc(width * 3);
+    memset(slots, 0, (size_t)frameBytes * WRITE_SLOTS); // fault the pages in now, not during the first frames
+
+    hasPixelBuffers = GLEW_ARB_pixel_buffer_object;
+    if (hasPixelBuffers)
+    {
+        glGenBuffers(PBO_RING, pixelBuffers);
+        for (int i = 0; i < PBO_RING; i++)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    else
+    {
+        std::cout << "capture: pixel buffer objects not supported, frames are read synchronously" << std::endl;
+    }
+
+    stopping = 0;
+    writer = std::thread(&FrameCapture::writerLoop, this);
+    isActive = 1;
+    return 1;
+}
+
+void FrameCapture::grab()
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    // BGRA is the layout drivers keep framebuffers in, so the readback is a plain copy
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    if (hasPixelBuffers)
+    {
+        // queue the copy into the next buffer, glReadPixels returns without waiting for it
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[framesRead % PBO_RING]);
+        glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+        framesRead++;
+
+        if (framesRead - framesMapped >= PBO_RING)
+        {
+            mapOldest();
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    else
+    {
+        unsigned char *slot = acquireSlot();
+        if (slot)
+        {
+            glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, slot);
+            commitSlot(framesCaptured);
+        }
+    }
+
+    float ms = (float)((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+    captureMsTotal += ms;
+    captureMsMax = ms > captureMsMax ? ms : captureMsMax;
+    framesCaptured++;
+    if (ms > BUDGET_MS)
+    {
+        framesOverBudget++;
+    }
+}
+
+void FrameCapture::mapOldest()
+{
+    // read PBO_RING - 1 frames ago, the GPU finished that copy and mapping does not wait
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[framesMapped % PBO_RING]);
+    const unsigned char *pixels = (const unsigned char *)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (pixels)
+    {
+        unsigned char *slot = acquireSlot();
+        if (slot)
+        {
+            memcpy(slot, pixels, frameBytes);
+            commitSlot(framesMapped);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        framesDropped++; // the frame was read back but is lost all the same
+    }
+    framesMapped++;
+}
+
+unsigned char *FrameCapture::acquireSlot()
+{
+    // the writer only touches slots between slotsWritten and slotsQueued, the next one is ours
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slotsQueued - slotsWritten >= WRITE_SLOTS)
+    {
+        // a slow disk loses frames rather than slowing the game down
+        framesDropped++;
+        return nullptr;
+    }
+    return slots + (size_t)(slotsQueued % WRITE_SLOTS) * frameBytes;
+}
+
+void FrameCapture::commitSlot(int frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        slotFrames[slotsQueued % WRITE_SLOTS] = frame;
+        slotsQueued++;
+    }
+    wakeUp.notify_one();
+}
+
+void FrameCapture::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (1)
+    {
+        wakeUp.wait(lock, [this] { return stopping || slotsWritten < slotsQueued; });
+        if (slotsWritten == slotsQueued)
+        {
+            break; // stopping and everything queued is on disk
+        }
+
+        // PPMs are named by frame, so dropped frames leave gaps in the numbering
+        int slot = slotsWritten % WRITE_SLOTS;
+        int frame = slotFrames[slot];
+        lock.unlock();
+        writeFrame(slots + (size_t)slot * frameBytes, frame);
+        lock.lock();
+
+        slotsWritten++;
+        framesWritten++;
+    }
+}
+
+bool FrameCapture::isFramePattern(const char *path)
+{
+    int conversions = 0;
+    for (const char *c = path; *c; c++)
+    {
+        if (*c != '%')
+        {
+            continue;
+        }
+        c++;
+        if (*c == '%')
+        {
+            continue;
+        }
+        while (*c && strchr("-+ 0#", *c))
+        {
+            c++;
+        }
+        while (*c >= '0' && *c <= '9')
+        {
+            c++;
+        }
+        if (!*c || !strchr("diuxXo", *c))
+        {
+            return 0;
+        }
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+void FrameCapture::writeFrame(const unsigned char *pixels, int frame)
+{
+    if (!isSequence)
+    {
+        // raw video keeps the GL layout, BGRA with the bottom row first
+        fwrite(pixels, 1, frameBytes, rawFile);
+        return;
+    }
+
+    char filename[256];
+    snprintf(filename, sizeof(filename), path, frame);
+    FILE *file = fopen(filename, "wb");
+    if (!file)
+    {
+        std::cout << "capture: cannot write " << filename << std::endl;
+        return;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+    // GL rows start at the bottom, PPM rows at the top
+    for (int y = height - 1; y >= 0; y--)
+    {
+        const unsigned char *row = pixels + (size_t)y * width * 4;
+        for (int x = 0; x < width; x++)
+        {
+            rowBuffer[x * 3 + 0] = row[x * 4 + 2];
+            rowBuffer[x * 3 + 1] = row[x * 4 + 1];
+            rowBuffer[x * 3 + 2] = row[x * 4 + 0];
+        }
+        fwrite(rowBuffer, 1, width * 3, file);
+    }
+
+    fclose(file);
+}
+
+void FrameCapture::finish()
+{
+    if (!isActive)
+    {
+        return;
+    }
+
+    // the last frames are still in the ring, mapping them now may wait for the GPU
+    while (hasPixelBuffers && framesMapped < framesRead)
+    {
+        mapOldest();
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    stopWriter();
+    isActive = 0;
+}
+
+void FrameCapture::stopWriter()
+{
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = 1;
+        }
+        wakeUp.notify_one();
+        writer.join();
+    }
+
+    if (rawFile)
+    {
+        fclose(rawFile);
+        rawFile = nullptr;
+    }
+}
+
+void FrameCapture::report()
+{
+    std::cout << "capture: " << framesWritten << " frames written to " << path << ", " << framesDropped
+              << " dropped" << std::endl;
+    if (!framesCaptured)
+    {
+        return;
+    }
+
+    float average = (float)(captureMsTotal / framesCaptured);
+    std::cout << "  added frame time ms: avg " << average << ", max " << captureMsMax << ", "
+              << framesOverBudget << " frames over " << BUDGET_MS << " ms" << std::endl;
+    if (!isSequence)
+    {
+        std::cout << "  raw bgra " << width << "x" << height << ", bottom row first" << std::endl;
+    }
+}
+
+void FrameCapture::destroy()
+{
+    finish();
+
+    if (hasPixelBuffers)
+    {
+        glDeleteBuffers(PBO_RING, pixelBuffers);
+        hasPixelBuffers = 0;
+    }
+    free(slots);
+    slots = nullptr;
+    free(rowBuffer);
+    rowBuffer = nullptr;
+}
+
+FrameCapture::~FrameCapture()
+{
+    // GL objects must go while the context exists, that is destroy(); this only saves what is queued
+    stopWriter();
+    free(slots);
+    free(rowBuffer);
+}
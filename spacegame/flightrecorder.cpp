@@ -0,0 +1,114 @@
+
+#include <iostream>
+#include <cstdio>
+#include "include/flightrecorder.hpp"
+
+FlightRecorder::FlightRecorder()
+{
+    isEnabled = 0;
+    budgetMs = 50.0f;
+    seed = 0;
+    worldW = 0;
+    worldH = 0;
+    written = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        keyframes[i] = WorldSnapshot();
+        keyframes[i].tick = 0xFFFFFFFF;
+    }
+    lastDumpTick = 0;
+    dumps = 0;
+}
+
+void FlightRecorder::dumpSpike(const FlightRecord &spike)
+{
+    lastDumpTick = spike.tick;
+
+    int count = written < (Uint32)RECORDS ? (int)written : RECORDS;
+    Uint32 oldest = written - count;
+    Uint32 oldestTick = records[oldest % RECORDS].tick;
+
+    // the earliest keyframe whose following ticks are all still in the ring
+    const WorldSnapshot *keyframe = nullptr;
+    for (int i = 0; i < 2; i++)
+    {
+        const WorldSnapshot &candidate = keyframes[i];
+        if (candidate.tick != 0xFFFFFFFF && candidate.tick + 1 >= oldestTick && candidate.tick < spike.tick &&
+            (!keyframe || candidate.tick < keyframe->tick))
+        {
+            keyframe = &candidate;
+        }
+    }
+
+    char filename[64];
+    snprintf(filename, sizeof(filename), "flight_%u_%u.bin", seed, spike.tick);
+    FILE *file = fopen(filename, "wb");
+    if (!file)
+    {
+        std::cout << "flight recorder: cannot write " << filename << std::endl;
+        return;
+    }
+
+    FlightHeader header;
+    header.magic = FLIGHT_MAGIC;
+    header.version = FLIGHT_VERSION;
+    header.recordSize = sizeof(FlightRecord);
+    header.snapshotSize = keyframe ? sizeof(WorldSnapshot) : 0;
+    header.seed = seed;
+    header.worldW = worldW;
+    header.worldH = worldH;
+    header.budgetMs = budgetMs;
+    header.spikeTick = spike.tick;
+    header.recordsCount = count;
+
+    fwrite(&header, sizeof(header), 1, file);
+    for (int i = 0; i < count; i++)
+    {
+        fwrite(&records[(oldest + i) % RECORDS], sizeof(FlightRecord), 1, file);
+    }
+    if (keyframe)
+    {
+        fwrite(keyframe, sizeof(WorldSnapshot), 1, file);
+    }
+    fclose(file);
+
+    dumps++;
+    std::cout << "flight recorder: tick " << spike.tick << " took " << spike.workMs << " ms, last "
+              << count << " frames saved to " << filename << std::endl;
+}
+
+bool FlightRecorder::load(const char *path, FlightHeader &header)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        std::cout << "flight recorder: cannot read " << path << std::endl;
+        return 0;
+    }
+
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == FLIGHT_MAGIC &&
+              header.version == FLIGHT_VERSION && header.recordSize == sizeof(FlightRecord) &&
+              header.recordsCount <= (Uint32)RECORDS &&
+              (header.snapshotSize == 0 || header.snapshotSize == sizeof(WorldSnapshot));
+
+    // a different build may lay out the snapshot differently, the size check above catches most of it
+    ok = ok && fread(records, sizeof(FlightRecord), header.recordsCount, file) == header.recordsCount;
+    if (ok && header.snapshotSize)
+    {
+        ok = fread(&keyframes[0], sizeof(WorldSnapshot), 1, file) == 1;
+    }
+    fclose(file);
+
+    if (!ok)
+    {
+        std::cout << "flight recorder: " << path << " is not a flight dump of this build" << std::endl;
+        return 0;
+    }
+
+    written = header.recordsCount;
+    seed = header.seed;
+    worldW = header.worldW;
+    worldH = header.worldH;
+    budgetMs = header.budgetMs;
+    return 1;
+}
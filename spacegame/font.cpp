@@ -1,29 +1,191 @@
 
+#include <cmath>
+#include <algorithm>
 #include "include/font.hpp"
 
+constexpr float FontRenderer::SDF_SPREAD;
+
 FontRenderer::FontRenderer()
 {
+    symW = 0;
+    symH = 0;
+    sheetTexture = 0;
+
+    sdfTexture = 0;
+    sdfProgram = 0;
+    sdfSmoothingUniform = -1;
+    sdfSymW = 0;
+    sdfSymH = 0;
+    sdfRequested = 0;
+
+    arena = nullptr;
 }
 
-void FontRenderer::createPrintableAsciiCharsTexturesFromPng(const char *filename, int symW, int symH)
+void FontRenderer::loadPrintableAsciiCharsFromPng(const char *filename, int symW, int symH)
+    {
+        this->symW = symW;
+        this->symH = symH;
+
+        SDL_Surface *surface = loadFontSheet(filename);
+        if (surface)
+        {
+            glyphCache.setSource(surface, symW, symH);
+        }
+    }
+
+void FontRenderer::loadPrintableAsciiCharsAsync(AssetLoader &loader, const char *filename, int symW, int symH)
     {
-        SDL_Surface *surface = IMG_Load(filename);
+        this->symW = symW;
+        this->symH = symH;
 
+        // decode and convert on the loader thread, glyphs are rasterized into the cache on first use
+        loader.submit([this, filename](AssetLoader &loader) {
+            SDL_Surface *surface = loadFontSheet(filename);
+            if (surface)
+            {
+                loader.push(FONT_SHEET_IMAGE, 0, surface);
+            }
+        });
+    }
+
+SDL_Surface *FontRenderer::loadFontSheet(const char *filename)
+    {
+        SDL_Surface *loaded = IMG_Load(filename);
+        if (!loaded)
+        {
+            std::cout << "font load problem: " << IMG_GetError() << std::endl;
+            return nullptr;
+        }
+
+        SDL_Surface *surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(loaded);
+        if (!surface)
+        {
+            return nullptr;
+        }
+
+        keyBlackAsTransparent(surface);
+        return surface;
+    }
+
+int FontRenderer::uploadLoadedGlyphs(AssetLoader &loader, int maxUploads)
+    {
+        int uploads = 0;
+        LoadedImage image;
+        while (uploads < maxUploads && loader.pop(image))
+        {
+            if (image.kind == SDF_ATLAS_IMAGE)
+            {
+                sdfTexture = createTextureFromSurface(image.surface);
+                createSdfProgram();
+                SDL_FreeSurface(image.surface);
+            }
+            else
+            {
+                // texels map 1:1 to pixels at integer positions, nearest keeps them sharp
+                sheetTexture = createTextureFromSurface(image.surface);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+                // the cache keeps the sheet as the source for on-demand rasterizing
+                glyphCache.setSource(image.surface, symW, symH);
+            }
+            uploads++;
+        }
+        return uploads;
+    }
+
+void FontRenderer::loadSdfAtlasAsync(AssetLoader &loader, const char *filename, int symW, int symH)
+    {
+        sdfSymW = symW;
+        sdfSymH = symH;
+        sdfRequested = 1;
+
+        // the distance transform is the expensive part, keep it off the GL thread
+        loader.submit([this, filename, symW, symH](AssetLoader &loader) {
+            SDL_Surface *surface = loadFontSheet(filename);
+            if (surface)
+            {
+                loader.push(SDF_ATLAS_IMAGE, 0, createSdfAtlasSurface(surface, symW, symH));
+                SDL_FreeSurface(surface);
+            }
+        });
+    }
+
+SDL_Surface *FontRenderer::createSdfAtlasSurface(SDL_Surface *surface, int symW, int symH)
+    {
+        int cellW = symW * SDF_SCALE;
+        int cellH = symH * SDF_SCALE;
+        SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, cellW * SDF_COLUMNS, cellH * SDF_ROWS, 32, SDL_PIXELFORMAT_RGBA32);
+
+        Uint32 p32, *buf32;
+        Uint8 r, g, b, a;
+
+        int srcW = surface->w;
         int offX = 0;
         int offY = 0;
+        int radius = (int)SDF_SPREAD + 1;
 
-        SDL_Surface *newSurface;
-        newSurface = nullptr;
+        bool *inside = new bool[symW * symH];
 
-        int srcW = surface->w;
-      
-        GLuint textureID = 0;
         for (int i = 0; i < 95; ++i)
         {
-            newSurface = getPartOfSurfaceAsNewSurface(surface, symW, symH, offX, offY);
-            textureID = createTextureFromSurface(newSurface);
-            fontTextures[i] = textureID;
-            SDL_FreeSurface(newSurface);
+            // same rule as the sprite glyphs: black is background, anything else is ink
+            buf32 = (Uint32 *)surface->pixels;
+            for (int y = 0; y < symH; y++)
+            {
+                for (int x = 0; x < symW; x++)
+                {
+                    p32 = buf32[(offY + y) * srcW + (offX + x)];
+                    SDL_GetRGBA(p32, surface->format, &r, &g, &b, &a);
+                    inside[y * symW + x] = !(r == 0 && g == 0 && b == 0);
+                }
+            }
+
+            int atlasX = (i % SDF_COLUMNS) * cellW;
+            int atlasY = (i / SDF_COLUMNS) * cellH;
+
+            for (int oy = 0; oy < cellH; oy++)
+            {
+                for (int ox = 0; ox < cellW; ox++)
+                {
+                    // sample point in source pixel units
+                    float sx = (ox + 0.5f) / SDF_SCALE;
+                    float sy = (oy + 0.5f) / SDF_SCALE;
+                    int px = (int)sx;
+                    int py = (int)sy;
+                    bool in = inside[py * symW + px];
+
+                    // distance to the closest source pixel of the other kind, capped at the spread
+                    float best = SDF_SPREAD;
+                    for (int ny = py - radius; ny <= py + radius; ny++)
+                    {
+                        for (int nx = px - radius; nx <= px + radius; nx++)
+                        {
+                            bool nIn = nx >= 0 && nx < symW && ny >= 0 && ny < symH && inside[ny * symW + nx];
+                            if (nIn == in)
+                            {
+                                continue;
+                            }
+
+                            float dx = std::max(0.0f, std::max(nx - sx, sx - (nx + 1)));
+                            float dy = std::max(0.0f, std::max(ny - sy, sy - (ny + 1)));
+                            float d = std::sqrt(dx * dx + dy * dy);
+                            if (d < best)
+                            {
+                                best = d;
+                            }
+                        }
+                    }
+
+                    float value = 0.5f + (in ? best : -best) / (2.0f * SDF_SPREAD);
+                    Uint8 alpha = (Uint8)(std::min(1.0f, std::max(0.0f, value)) * 255.0f + 0.5f);
+
+                    Uint8 *pixelPtr = static_cast<Uint8 *>(atlas->pixels) + (atlasY + oy) * atlas->pitch + (atlasX + ox) * atlas->format->BytesPerPixel;
+                    Uint32 *pixel = reinterpret_cast<Uint32 *>(pixelPtr);
+                    *pixel = SDL_MapRGBA(atlas->format, 255, 255, 255, alpha);
+                }
+            }
 
             offX += symW;
             if (offX >= srcW)
@@ -32,39 +194,92 @@ void FontRenderer::createPrintableAsciiCharsTexturesFromPng(const char *filename
                 offY += symH;
             }
         }
-        SDL_FreeSurface(surface);
+
+        delete[] inside;
+        return atlas;
     }
 
-SDL_Surface *FontRenderer::getPartOfSurfaceAsNewSurface(SDL_Surface *surface, int symW, int symH, int offX, int offY)
+void FontRenderer::createSdfProgram()
     {
-        SDL_Surface *newSurface = SDL_CreateRGBSurfaceWithFormat(0, symW, symH, 32, SDL_PIXELFORMAT_RGBA32);
+        if (!GLEW_VERSION_2_0)
+        {
+            return;
+        }
 
-        Uint32 p32, *buf32;
+        static const char *vertexSource =
+            "void main()\n"
+            "{\n"
+            "    gl_Position = ftransform();\n"
+            "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+            "    gl_FrontColor = gl_Color;\n"
+            "}\n";
+
+        static const char *fragmentSource =
+            "uniform sampler2D atlas;\n"
+            "uniform float smoothing;\n"
+            "void main()\n"
+            "{\n"
+            "    float distance = texture2D(atlas, gl_TexCoord[0].st).a;\n"
+            "    float alpha = smoothstep(0.5 - smoothing, 0.5 + smoothing, distance);\n"
+            "    gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * alpha);\n"
+            "}\n";
+
+        GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertexShader, 1, &vertexSource, nullptr);
+        glCompileShader(vertexShader);
+
+        GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragmentShader, 1, &fragmentSource, nullptr);
+        glCompileShader(fragmentShader);
+
+        GLuint program = glCreateProgram();
+        glAttachShader(program, vertexShader);
+        glAttachShader(program, fragmentShader);
+        glLinkProgram(program);
+
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            // alpha test still gives sharp edges, just without antialiasing
+            glDeleteProgram(program);
+            return;
+        }
+
+        sdfProgram = program;
+        sdfSmoothingUniform = glGetUniformLocation(program, "smoothing");
+
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "atlas"), 0);
+        glUseProgram(0);
+    }
+
+bool FontRenderer::isLoaded()
+    {
+        return glyphCache.hasSource() && (!sdfRequested || sdfTexture);
+    }
+
+void FontRenderer::keyBlackAsTransparent(SDL_Surface *surface)
+    {
+        Uint32 *pixel;
         Uint8 r, g, b, a;
 
-        int srcW = surface->w;
-        
-        for (int y = 0; y < symH; y++)
+        for (int y = 0; y < surface->h; y++)
         {
-            for (int x = 0; x < symW; x++)
+            pixel = reinterpret_cast<Uint32 *>(static_cast<Uint8 *>(surface->pixels) + y * surface->pitch);
+            for (int x = 0; x < surface->w; x++, pixel++)
             {
-                buf32 = (Uint32 *)surface->pixels;
-                p32 = buf32[(offY + y) * srcW + (offX + x)];
-
-                SDL_GetRGBA(p32, surface->format, &r, &g, &b, &a);
+                SDL_GetRGBA(*pixel, surface->format, &r, &g, &b, &a);
 
                 if (r == 0 && g == 0 && b == 0)
                 {
-                    a = 0;
+                    *pixel = SDL_MapRGBA(surface->format, r, g, b, 0);
                 }
-
-                Uint8 *pixelPtr = static_cast<Uint8 *>(newSurface->pixels) + y * newSurface->pitch + x * newSurface->format->BytesPerPixel;
-                Uint32 *pixel = reinterpret_cast<Uint32 *>(pixelPtr);
-                *pixel = SDL_MapRGBA(newSurface->format, r, g, b, a);
             }
         }
-
-        return newSurface;
     }
 
 GLuint FontRenderer::createTextureFromSurface(SDL_Surface *surface)
@@ -80,52 +295,155 @@ GLuint FontRenderer::createTextureFromSurface(SDL_Surface *surface)
         return textureID;
     }
 
-void FontRenderer::renderTextureBlock(GLuint texture, float x, float y, float textureWidth, float textureHeight)
+void FontRenderer::renderInt(int number, int posX, int posY)
+{
+    char *text = myIntToStr(number);
+    renderText(text, posX, posY);
+}
+
+void FontRenderer::renderText(const char *str, int posX, int posY)
     {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texture);
+        static const int CHUNK = 128;
+        const CachedGlyph *chunk[CHUNK];
+        int chunkX[CHUNK];
 
+        glEnable(GL_TEXTURE_2D);
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-        glBegin(GL_TRIANGLES);
-        glTexCoord2f(0, 1);
-        glVertex2f(x, y);
+        while (*str != '\0')
+        {
+            // resolve first: rasterizing uploads into pages, which is not allowed inside glBegin/glEnd
+            glyphCache.beginUse();
+            int count = 0;
+            while (*str != '\0' && count < CHUNK)
+            {
+                Uint32 codepoint = GlyphCache::decodeUtf8(str);
+                if (codepoint < 32 || codepoint == 127)
+                {
+                    continue; // control characters take no space
+                }
 
-        glTexCoord2f(1, 1);
-        glVertex2f(x + textureWidth, y);
+                chunk[count] = glyphCache.lookup(codepoint);
+                chunkX[count] = posX;
+                count++;
+                posX += symW;
+            }
+
+            // then one batch per atlas page
+            for (int page = 0; page < glyphCache.pagesCount; page++)
+            {
+                bool bound = 0;
+                for (int i = 0; i < count; i++)
+                {
+                    const CachedGlyph *glyph = chunk[i];
+                    if (!glyph || glyph->page != page)
+                    {
+                        continue;
+                    }
 
-        glTexCoord2f(1, 0);
-        glVertex2f(x + textureWidth, y + textureHeight);
+                    if (!bound)
+                    {
+                        glBindTexture(GL_TEXTURE_2D, glyphCache.pages[page].texture);
+                        glBegin(GL_QUADS);
+                        bound = 1;
+                    }
 
-        glTexCoord2f(1, 0);
-        glVertex2f(x + textureWidth, y + textureHeight);
+                    float x = (float)chunkX[i];
+                    float y = (float)posY;
+                    glTexCoord2f(glyph->s0, glyph->t1);
+                    glVertex2f(x, y);
+                    glTexCoord2f(glyph->s1, glyph->t1);
+                    glVertex2f(x + symW, y);
+                    glTexCoord2f(glyph->s1, glyph->t0);
+                    glVertex2f(x + symW, y + symH);
+                    glTexCoord2f(glyph->s0, glyph->t0);
+                    glVertex2f(x, y + symH);
+                }
+                if (bound)
+                {
+                    glEnd();
+                }
+            }
+        }
 
-        glTexCoord2f(0, 0);
-        glVertex2f(x, y + textureHeight);
+        glDisable(GL_BLEND);
+        glDisable(GL_TEXTURE_2D);
+    }
 
-        glTexCoord2f(0, 1);
-        glVertex2f(x, y);
+void FontRenderer::renderTextScaled(const char *str, float posX, float posY, float scale)
+    {
+        if (!sdfTexture)
+        {
+            return;
+        }
+
+        float glyphW = sdfSymW * scale;
+        float glyphH = sdfSymH * scale;
+        float atlasW = (float)(sdfSymW * SDF_SCALE * SDF_COLUMNS);
+        float atlasH = (float)(sdfSymH * SDF_SCALE * SDF_ROWS);
+
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, sdfTexture);
+        beginSdf(scale);
+
+        // whole string in one batch from one texture
+        glBegin(GL_QUADS);
+        while (*str != '\0')
+        {
+            Uint32 codepoint = GlyphCache::decodeUtf8(str);
+            if (codepoint >= 32 && codepoint < 32 + 95)
+            {
+                int i = codepoint - 32;
+                float s0 = (i % SDF_COLUMNS) * sdfSymW * SDF_SCALE / atlasW;
+                float t0 = (i / SDF_COLUMNS) * sdfSymH * SDF_SCALE / atlasH;
+                float s1 = s0 + sdfSymW * SDF_SCALE / atlasW;
+                float t1 = t0 + sdfSymH * SDF_SCALE / atlasH;
+
+                glTexCoord2f(s0, t1);
+                glVertex2f(posX, posY);
+                glTexCoord2f(s1, t1);
+                glVertex2f(posX + glyphW, posY);
+                glTexCoord2f(s1, t0);
+                glVertex2f(posX + glyphW, posY + glyphH);
+                glTexCoord2f(s0, t0);
+                glVertex2f(posX, posY + glyphH);
+            }
+            posX += glyphW;
+        }
         glEnd();
 
-        glDisable(GL_BLEND);
+        endSdf();
         glDisable(GL_TEXTURE_2D);
     }
 
-void FontRenderer::renderInt(int number, int posX, int posY)
-{
-    char *text = myIntToStr(number);
-    renderText(text, posX, posY);
-}
+void FontRenderer::beginSdf(float scale)
+    {
+        if (sdfProgram)
+        {
+            // about half a screen pixel of antialiasing whatever the scale
+            glUseProgram(sdfProgram);
+            glUniform1f(sdfSmoothingUniform, std::min(0.5f, 0.25f / (SDF_SPREAD * scale)));
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+        else
+        {
+            glEnable(GL_ALPHA_TEST);
+            glAlphaFunc(GL_GEQUAL, 0.5f);
+        }
+    }
 
-void FontRenderer::renderText(const char *str, int posX, int posY)
+void FontRenderer::endSdf()
     {
-        while (*str != '\0')
+        if (sdfProgram)
+        {
+            glUseProgram(0);
+            glDisable(GL_BLEND);
+        }
+        else
         {
-            int asciiCode = static_cast<int>(*str);
-            renderTextureBlock(fontTextures[asciiCode - 32], posX, posY, 12, 16);
-            posX += 12;
-            ++str;
+            glDisable(GL_ALPHA_TEST);
         }
     }
 
@@ -138,7 +456,12 @@ char *FontRenderer::myIntToStr(int num)
         {
             digts++;
         }
-        char *str = new char[digts + 1];
+        // valid until the arena is reset at the end of the frame
+        char *str = arena ? arena->allocArray<char>(digts + 1) : nullptr;
+        if (!str)
+        {
+            str = intBuffer;
+        }
         for (int i = digts - 1; i >= 0; i--)
         {
             int digit = num % 10;
@@ -151,4 +474,17 @@ char *FontRenderer::myIntToStr(int num)
 
 FontRenderer::~FontRenderer()
 {
+    glyphCache.destroy();
+    if (sdfProgram)
+    {
+        glDeleteProgram(sdfProgram);
+    }
+    if (sdfTexture)
+    {
+        glDeleteTextures(1, &sdfTexture);
+    }
+    if (sheetTexture)
+    {
+        glDeleteTextures(1, &sheetTexture);
+    }
 }
\ No newline at end of file
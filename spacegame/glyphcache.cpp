@@ -0,0 +1,375 @@
+
+#include <cstring>
+#include "include/glyphcache.hpp"
+
+// Latin-1 letters folded to the closest ASCII glyph, the sheet has nothing else
+static const char latin1Fold[] = "AAAAAAACEEEEIIIIDNOOOOOxOUUUUYPsaaaaaaaceeeeiiiidnooooo/ouuuuypy";
+
+static inline Uint32 hashCodepoint(Uint32 codepoint)
+{
+    return (codepoint * 2654435761u) >> 22; // top 10 bits, HASH_SIZE == 1024
+}
+
+GlyphCache::GlyphCache()
+{
+    pagesCount = 0;
+    for (int i = 0; i < MAX_PAGES; i++)
+    {
+        pages[i].texture = 0;
+    }
+
+    freeCount = 0;
+    for (int i = MAX_GLYPHS - 1; i >= 0; i--)
+    {
+        glyphs[i].page = -1;
+        freeSlots[freeCount++] = i;
+    }
+
+    for (int i = 0; i < HASH_SIZE; i++)
+    {
+        hashKeys[i] = EMPTY_KEY;
+        hashSlots[i] = -1;
+    }
+
+    source = nullptr;
+    symW = 0;
+    symH = 0;
+    glyphPixels = nullptr;
+    useCounter = 0;
+}
+
+void GlyphCache::setSource(SDL_Surface *sheet, int symW, int symH)
+{
+    if (source)
+    {
+        SDL_FreeSurface(source);
+    }
+    source = sheet;
+    this->symW = symW;
+    this->symH = symH;
+
+    delete[] glyphPixels;
+    glyphPixels = new Uint32[symW * symH];
+}
+
+bool GlyphCache::hasSource()
+{
+    return source != nullptr;
+}
+
+void GlyphCache::beginUse()
+{
+    // pages touched after this call are protected from eviction until the next one
+    useCounter++;
+}
+
+const CachedGlyph *GlyphCache::lookup(Uint32 codepoint)
+{
+    int slot = findSlot(codepoint);
+    if (slot < 0)
+    {
+        slot = rasterize(codepoint);
+        if (slot < 0)
+        {
+            return nullptr;
+        }
+    }
+
+    pages[glyphs[slot].page].lastUsed = useCounter;
+    return &glyphs[slot];
+}
+
+Uint32 GlyphCache::decodeUtf8(const char *&str)
+{
+    const unsigned char *s = reinterpret_cast<const unsigned char *>(str);
+    Uint32 codepoint;
+    int length;
+
+    if (s[0] < 0x80)
+    {
+        str += 1;
+        return s[0];
+    }
+    else if ((s[0] & 0xE0) == 0xC0)
+    {
+        codepoint = s[0] & 0x1F;
+        length = 2;
+    }
+    else if ((s[0] & 0xF0) == 0xE0)
+    {
+        codepoint = s[0] & 0x0F;
+        length = 3;
+    }
+    else if ((s[0] & 0xF8) == 0xF0)
+    {
+        codepoint = s[0] & 0x07;
+        length = 4;
+    }
+    else
+    {
+        str += 1;
+        return REPLACEMENT_CHAR;
+    }
+
+    for (int i = 1; i < length; i++)
+    {
+        // also stops at the terminating zero of a truncated sequence
+        if ((s[i] & 0xC0) != 0x80)
+        {
+            str += i;
+            return REPLACEMENT_CHAR;
+        }
+        codepoint = (codepoint << 6) | (s[i] & 0x3F);
+    }
+    str += length;
+
+    static const Uint32 minimum[] = {0, 0, 0x80, 0x800, 0x10000};
+    if (codepoint < minimum[length] || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+    {
+        return REPLACEMENT_CHAR;
+    }
+    return codepoint;
+}
+
+int GlyphCache::findSlot(Uint32 codepoint)
+{
+    Uint32 i = hashCodepoint(codepoint);
+    while (hashKeys[i] != EMPTY_KEY)
+    {
+        if (hashKeys[i] == codepoint)
+        {
+            return hashSlots[i];
+        }
+        i = (i + 1) & (HASH_SIZE - 1);
+    }
+    return -1;
+}
+
+void GlyphCache::insertSlot(Uint32 codepoint, int slot)
+{
+    Uint32 i = hashCodepoint(codepoint);
+    while (hashKeys[i] != EMPTY_KEY)
+    {
+        i = (i + 1) & (HASH_SIZE - 1);
+    }
+    hashKeys[i] = codepoint;
+    hashSlots[i] = slot;
+}
+
+void GlyphCache::eraseSlot(Uint32 codepoint)
+{
+    Uint32 i = hashCodepoint(codepoint);
+    while (hashKeys[i] != codepoint)
+    {
+        if (hashKeys[i] == EMPTY_KEY)
+        {
+            return;
+        }
+        i = (i + 1) & (HASH_SIZE - 1);
+    }
+
+    // backward shift deletion keeps probe chains intact without tombstones
+    Uint32 j = i;
+    while (1)
+    {
+        j = (j + 1) & (HASH_SIZE - 1);
+        if (hashKeys[j] == EMPTY_KEY)
+        {
+            break;
+        }
+        Uint32 home = hashCodepoint(hashKeys[j]);
+        bool movable = (j > i) ? (home <= i || home > j) : (home <= i && home > j);
+        if (movable)
+        {
+            hashKeys[i] = hashKeys[j];
+            hashSlots[i] = hashSlots[j];
+            i = j;
+        }
+    }
+    hashKeys[i] = EMPTY_KEY;
+    hashSlots[i] = -1;
+}
+
+int GlyphCache::rasterize(Uint32 codepoint)
+{
+    if (!source)
+    {
+        return -1;
+    }
+
+    int page, x, y;
+    if (!freeCount || !allocate(symW, symH, page, x, y))
+    {
+        return -1;
+    }
+
+    Uint32 *pixels = glyphPixels;
+    renderGlyphPixels(codepoint, pixels);
+
+    glBindTexture(GL_TEXTURE_2D, pages[page].texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, symW, symH, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    int slot = freeSlots[--freeCount];
+    CachedGlyph &glyph = glyphs[slot];
+    glyph.codepoint = codepoint;
+    glyph.page = page;
+    glyph.s0 = (float)x / PAGE_SIZE;
+    glyph.t0 = (float)y / PAGE_SIZE;
+    glyph.s1 = (float)(x + symW) / PAGE_SIZE;
+    glyph.t1 = (float)(y + symH) / PAGE_SIZE;
+
+    insertSlot(codepoint, slot);
+    return slot;
+}
+
+bool GlyphCache::allocate(int w, int h, int &page, int &x, int &y)
+{
+    for (page = 0; page < pagesCount; page++)
+    {
+        if (allocateInPage(page, w, h, x, y))
+        {
+            return 1;
+        }
+    }
+
+    if (pagesCount < MAX_PAGES)
+    {
+        page = pagesCount++;
+        GlyphPage &newPage = pages[page];
+        newPage.shelvesCount = 0;
+        newPage.nextShelfY = 0;
+        newPage.lastUsed = useCounter;
+
+        glGenTextures(1, &newPage.texture);
+        glBindTexture(GL_TEXTURE_2D, newPage.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, PAGE_SIZE, PAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        return allocateInPage(page, w, h, x, y);
+    }
+
+    // all pages full: recycle the least recently used one that the current draw does not need
+    int oldest = -1;
+    for (int i = 0; i < pagesCount; i++)
+    {
+        if (pages[i].lastUsed != useCounter && (oldest < 0 || pages[i].lastUsed < pages[oldest].lastUsed))
+        {
+            oldest = i;
+        }
+    }
+    if (oldest < 0)
+    {
+        return 0;
+    }
+
+    evictPage(oldest);
+    page = oldest;
+    return allocateInPage(page, w, h, x, y);
+}
+
+bool GlyphCache::allocateInPage(int page, int w, int h, int &x, int &y)
+{
+    GlyphPage &p = pages[page];
+
+    // first shelf that is tall enough without wasting more than half its height
+    for (int i = 0; i < p.shelvesCount; i++)
+    {
+        if (h <= p.shelfH[i] && h * 2 > p.shelfH[i] && p.shelfX[i] + w <= PAGE_SIZE)
+        {
+            x = p.shelfX[i];
+            y = p.shelfY[i];
+            p.shelfX[i] += w + 1; // one texel gap so neighbours never bleed
+            return 1;
+        }
+    }
+
+    if (p.shelvesCount < GlyphPage::MAX_SHELVES && p.nextShelfY + h <= PAGE_SIZE && w <= PAGE_SIZE)
+    {
+        int i = p.shelvesCount++;
+        p.shelfY[i] = p.nextShelfY;
+        p.shelfH[i] = h;
+        p.shelfX[i] = w + 1;
+        p.nextShelfY += h + 1;
+        x = 0;
+        y = p.shelfY[i];
+        return 1;
+    }
+
+    return 0;
+}
+
+void GlyphCache::evictPage(int page)
+{
+    for (int i = 0; i < MAX_GLYPHS; i++)
+    {
+        if (glyphs[i].page == page)
+        {
+            eraseSlot(glyphs[i].codepoint);
+            glyphs[i].page = -1;
+            freeSlots[freeCount++] = i;
+        }
+    }
+
+    pages[page].shelvesCount = 0;
+    pages[page].nextShelfY = 0;
+}
+
+void GlyphCache::renderGlyphPixels(Uint32 codepoint, Uint32 *pixels)
+{
+    if (codepoint >= 0xC0 && codepoint <= 0xFF)
+    {
+        codepoint = latin1Fold[codepoint - 0xC0];
+    }
+
+    if (codepoint >= 32 && codepoint < 32 + 95)
+    {
+        int columns = source->w / symW;
+        int index = codepoint - 32;
+        int offX = (index % columns) * symW;
+        int offY = (index / columns) * symH;
+
+        for (int y = 0; y < symH; y++)
+        {
+            Uint8 *row = static_cast<Uint8 *>(source->pixels) + (offY + y) * source->pitch + offX * 4;
+            memcpy(&pixels[y * symW], row, symW * 4);
+        }
+        return;
+    }
+
+    // no glyph in the sheet: draw an outlined box so the character is still visible
+    Uint8 white[4] = {255, 255, 255, 255};
+    Uint32 ink;
+    memcpy(&ink, white, 4);
+    for (int y = 0; y < symH; y++)
+    {
+        for (int x = 0; x < symW; x++)
+        {
+            bool edge = (x == 1 || x == symW - 2) && y >= 2 && y <= symH - 3;
+            edge = edge || ((y == 2 || y == symH - 3) && x >= 1 && x <= symW - 2);
+            pixels[y * symW + x] = edge ? ink : 0;
+        }
+    }
+}
+
+void GlyphCache::destroy()
+{
+    for (int i = 0; i < pagesCount; i++)
+    {
+        glDeleteTextures(1, &pages[i].texture);
+        pages[i].texture = 0;
+    }
+    pagesCount = 0;
+}
+
+GlyphCache::~GlyphCache()
+{
+    if (source)
+    {
+        SDL_FreeSurface(source);
+    }
+    delete[] glyphPixels;
+}
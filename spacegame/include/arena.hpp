@@ -0,0 +1,80 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+// Counters for every operator new/delete in the program, arena.cpp replaces the global operators.
+Uint64 heapAllocations();
+
+Uint64 heapFrees();
+
+Sint64 heapLiveAllocations();
+
+// Linear allocator for data that only lives until the end of the frame: one bump pointer,
+// nothing is freed individually, reset() drops everything at once.
+class FrameArena
+{
+public:
+    char *buffer;
+    int capacity;
+    int used;
+    int highWater; // most bytes used in any frame
+    int overflows; // allocations refused because the arena was full
+
+    FrameArena();
+
+    bool create(int capacity);
+
+    void *alloc(int size, int align);
+
+    template <class T>
+    T *allocArray(int count)
+    {
+        return (T *)alloc(count * (int)sizeof(T), (int)alignof(T));
+    }
+
+    void reset();
+
+    void destroy();
+
+    ~FrameArena();
+};
+
+// Fixed number of objects allocated up front, handed out and taken back through a free list.
+template <class T, int N>
+class ObjectPool
+{
+public:
+    T objects[N];
+    int freeList[N];
+    int freeCount;
+
+    ObjectPool()
+    {
+        for (int i = 0; i < N; i++)
+        {
+            freeList[i] = N - 1 - i;
+        }
+        freeCount = N;
+    }
+
+    // a fresh default constructed object, or nullptr when all N are in use
+    T *acquire()
+    {
+        if (!freeCount)
+        {
+            return nullptr;
+        }
+        T *object = &objects[freeList[--freeCount]];
+        *object = T();
+        return object;
+    }
+
+    void release(T *object)
+    {
+        freeList[freeCount++] = (int)(object - objects);
+    }
+
+    int live()
+    {
+        return N - freeCount;
+    }
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <SDL2/SDL.h>
+
+class LoadedImage
+{
+public:
+    int kind;             // what the image is for, defined by the code that submitted the task
+    int index;            // slot the image belongs to, e.g. glyph index
+    SDL_Surface *surface; // RGBA32 pixels ready for glTexImage2D, owned by whoever pops it
+};
+
+// Decodes and converts images on a background thread. Finished pixel buffers
+// wait in a queue until the GL thread pops and uploads them.
+class AssetLoader
+{
+public:
+    AssetLoader();
+
+    void submit(std::function<void(AssetLoader &)> task);
+
+    void push(int kind, int index, SDL_Surface *surface);
+
+    bool pop(LoadedImage &image);
+
+    bool isBusy();
+
+    void stop();
+
+    ~AssetLoader();
+
+private:
+    void workerLoop();
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::deque<std::function<void(AssetLoader &)>> tasks;
+    std::deque<LoadedImage> ready;
+    int running; // tasks taken by the worker but not finished yet
+    bool stopping;
+};
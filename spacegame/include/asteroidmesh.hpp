@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+
+// Irregular asteroid outlines generated once and kept in one static vertex buffer.
+// Every shape is a triangle fan: centre, the outline points, then the first point again.
+class AsteroidMeshes
+{
+public:
+    static const int SIZE_CLASSES = 4; // asteroid sizes 15, 20, 25 and 30
+    static const int VARIANTS = 4;     // different shapes per size
+    static const int SHAPES = SIZE_CLASSES * VARIANTS;
+    static const int MAX_QUADS = 1024; // simple asteroids drawn in one batch
+
+    std::vector<float> vertices; // x,y pairs for all shapes, kept for the client array fallback
+    int first[SHAPES];
+    int count[SHAPES];
+    GLuint buffer; // 0 when buffer objects are not available
+
+    std::vector<float> quads; // x,y corners of the simple batch, sized once in generate
+    int quadsCount;
+
+    AsteroidMeshes();
+
+    void generate(unsigned int seed);
+
+    void upload();
+
+    static int shapeFor(float size, int variant);
+
+    void beginBatch();
+
+    void draw(int shape, float posX, float posY, float angle);
+
+    void endBatch();
+
+    void addQuad(float posX, float posY, float size);
+
+    void drawQuads();
+
+    void destroy();
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+// Window onto a world that can be larger than the screen. x, y is the world position
+// of the bottom-left corner of the view.
+class Camera
+{
+public:
+    float x, y;
+    float viewW, viewH;
+    float worldW, worldH;
+
+    Camera()
+    {
+        x = y = 0.0f;
+        viewW = worldW = 800.0f;
+        viewH = worldH = 600.0f;
+    }
+
+    void setView(float w, float h)
+    {
+        viewW = w;
+        viewH = h;
+    }
+
+    void setWorld(float w, float h)
+    {
+        worldW = w;
+        worldH = h;
+    }
+
+    // centre on the target but never show anything outside the world
+    void follow(float targetX, float targetY)
+    {
+        x = clamp(targetX - viewW / 2, 0.0f, worldW - viewW);
+        y = clamp(targetY - viewH / 2, 0.0f, worldH - viewH);
+    }
+
+    bool isVisible(float posX, float posY, float radius)
+    {
+        return posX + radius >= x && posX - radius <= x + viewW &&
+               posY + radius >= y && posY - radius <= y + viewH;
+    }
+
+private:
+    static float clamp(float value, float low, float high)
+    {
+        if (high < low)
+        {
+            return low;
+        }
+        return value < low ? low : (value > high ? high : value);
+    }
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdio>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+
+// Records every rendered frame without stalling the GL thread. Frames are read into a ring
+// of pixel buffer objects and mapped a few frames later, when the copy has long finished.
+// A writer thread saves them as one raw BGRA video file, or as numbered PPM images when
+// the path contains a printf pattern such as capture_%05d.ppm.
+class FrameCapture
+{
+public:
+    static const int PBO_RING = 4;       // a frame is mapped PBO_RING - 1 frames after its readback
+    static const int WRITE_SLOTS = 8;    // frames waiting for the writer, more are dropped
+    static constexpr float BUDGET_MS = 1.0f; // capture must not add more than this to a frame
+
+    int width, height;
+    int frameBytes;
+    bool isActive;
+
+    bool hasPixelBuffers; // without them every frame is read synchronously
+    GLuint pixelBuffers[PBO_RING];
+    int framesRead, framesMapped;
+
+    Uint64 framesDropped, framesWritten;
+
+    // time grab() adds to a frame, kept as totals so long runs do not allocate
+    double captureMsTotal;
+    float captureMsMax;
+    int framesCaptured, framesOverBudget;
+
+    FrameCapture();
+
+    bool create(const char *path, int width, int height);
+
+    void grab();
+
+    void finish();
+
+    void report();
+
+    void destroy();
+
+    ~FrameCapture();
+
+private:
+    void mapOldest();
+
+    unsigned char *acquireSlot();
+
+    void commitSlot(int frame);
+
+    void writerLoop();
+
+    void stopWriter();
+
+    void writeFrame(const unsigned char *pixels, int frame);
+
+    // the path is used as a printf format for the frame number, so it may hold one integer
+    // conversion like %05d and otherwise only %%
+    static bool isFramePattern(const char *path);
+
+    const char *path;
+    bool isSequence;
+    FILE *rawFile;
+
+    unsigned char *slots;    // WRITE_SLOTS frames of width * height BGRA pixels
+    unsigned char *rowBuffer; // one RGB row, used by the writer for PPM output
+    int slotFrames[WRITE_SLOTS]; // index of the frame read back into each slot, names PPM files
+    int slotsQueued, slotsWritten;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <SDL2/SDL.h>
+#include "gameobject.hpp"
+
+enum CollisionKind
+{
+    COLLISION_BULLET,
+    COLLISION_SHIP
+};
+
+class CollisionRecord
+{
+public:
+    Sint32 kind;   // CollisionKind
+    Sint32 target; // index into targets
+};
+
+// Collisions found in one tick, in the order they are resolved. Preallocated, a tick where
+// more than CAPACITY things collide keeps the first ones and counts the rest.
+template <int CAPACITY>
+class CollisionBuffer
+{
+public:
+    CollisionRecord records[CAPACITY];
+    int count;
+    int dropped;
+
+    CollisionBuffer()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        count = 0;
+        dropped = 0;
+    }
+
+    void push(int kind, int target)
+    {
+        if (count < CAPACITY)
+        {
+            records[count].kind = kind;
+            records[count].target = target;
+            count++;
+        }
+        else
+        {
+            dropped++;
+        }
+    }
+
+    // appends another buffer, e.g. one filled by a detection thread for a later range of targets
+    void append(const CollisionBuffer &other)
+    {
+        for (int i = 0; i < other.count; i++)
+        {
+            push(other.records[i].kind, other.records[i].target);
+        }
+        dropped += other.dropped;
+    }
+};
+
+inline bool boxesOverlap(const GameObject &a, const GameObject &b)
+{
+    return (a.posX + a.size >= b.posX - b.size) && (a.posX - a.size <= b.posX + b.size) &&
+           (a.posY + a.size >= b.posY - b.size) && (a.posY - a.size <= b.posY + b.size);
+}
+
+// Reads only, so disjoint [begin, end) ranges can run on different threads into their own
+// buffers; appended in range order they give the same records as one pass. Only targets at
+// full simulation rate collide, far ones are out of the ship's and the bullet's reach.
+template <int CAPACITY>
+void detectCollisions(int kind, const GameObject &probe, const std::vector<GameObject *> &targets,
+                      size_t begin, size_t end, CollisionBuffer<CAPACITY> &out)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        const GameObject &target = *targets[i];
+        if (target.status && target.lodStep == 1 && boxesOverlap(probe, target))
+        {
+            out.push(kind, (int)i);
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include "snapshot.hpp"
+
+const Uint32 FLIGHT_MAGIC = 0x52465753; // "SWFR"
+const Uint32 FLIGHT_VERSION = 3;
+
+enum FlightKeys
+{
+    FLIGHT_KEY_UP = 1,
+    FLIGHT_KEY_DOWN = 2,
+    FLIGHT_KEY_LEFT = 4,
+    FLIGHT_KEY_RIGHT = 8
+};
+
+// One frame: the input Update saw, how long the phases took and what the world looked like after.
+class FlightRecord
+{
+public:
+    Uint32 tick; // after Update
+    Uint32 keys; // FlightKeys
+    Uint32 spacePresses; // unconsumed presses when Update started
+    Uint32 quality;      // simulation quality level Update ran at
+    Uint32 state;
+    Sint32 score, level, shield;
+    Uint32 targets, particles;
+    Uint32 rngState;
+    Uint32 allocations;
+    float workMs; // events to the end of Render before the swap, waiting excluded
+    float updateMs, renderMs; // renderMs stops before the swap too
+};
+
+class FlightHeader
+{
+public:
+    Uint32 magic;
+    Uint32 version;
+    Uint32 recordSize;
+    Uint32 snapshotSize;
+    Uint32 seed;
+    float worldW, worldH;
+    float budgetMs;
+    Uint32 spikeTick;
+    Uint32 recordsCount; // records follow oldest first, then the keyframe snapshot
+};
+
+// Keeps the last RECORDS frames in memory; a frame costs one record copy. Every
+// KEYFRAME_INTERVAL ticks the world is also saved, so a dump holds a snapshot the
+// recorded inputs can be replayed from, see SpaceGame::runReplay.
+class FlightRecorder
+{
+public:
+    static const int RECORDS = 256; // a little over 4 seconds at 60 fps
+    static const int KEYFRAME_INTERVAL = RECORDS / 2; // a keyframe is always inside the ring
+
+    bool isEnabled;
+    float budgetMs; // frames with more work than this are dumped
+    Uint32 seed;
+    float worldW, worldH;
+
+    FlightRecord records[RECORDS];
+    Uint32 written;
+    WorldSnapshot keyframes[2];
+    Uint32 lastDumpTick;
+    int dumps;
+
+    FlightRecorder();
+
+    bool isKeyframeTick(Uint32 tick)
+    {
+        return isEnabled && tick % KEYFRAME_INTERVAL == 0;
+    }
+
+    WorldSnapshot &keyframeFor(Uint32 tick)
+    {
+        return keyframes[(tick / KEYFRAME_INTERVAL) % 2];
+    }
+
+    FlightRecord &next()
+    {
+        return records[written % RECORDS];
+    }
+
+    // a spike right after a dump would mostly repeat it, the next one waits for fresh frames
+    void commit(bool checkBudget)
+    {
+        const FlightRecord &record = records[written % RECORDS];
+        written++;
+        if (checkBudget && record.workMs > budgetMs && (!dumps || record.tick - lastDumpTick >= (Uint32)RECORDS))
+        {
+            dumpSpike(record);
+        }
+    }
+
+    // reads a dump back into records, keyframes[0] and the header fields
+    bool load(const char *path, FlightHeader &header);
+
+private:
+    void dumpSpike(const FlightRecord &record);
+};
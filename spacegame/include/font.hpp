@@ -3,26 +3,100 @@
 #include <GL/glew.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
+#include "assets.hpp"
+#include "glyphcache.hpp"
+#include "arena.hpp"
+#include "fixedfont.hpp"
+
+// pixfont.png: 16 columns of 12x16 glyphs from ' ' to '~', the SDF atlas uses the same grid
+typedef FixedFont<12, 16> PixFont;
 
 class FontRenderer
 {
 public:
-    GLuint fontTextures[95]; // ASCII printable characters as textures
+    enum ImageKind
+    {
+        FONT_SHEET_IMAGE,
+        SDF_ATLAS_IMAGE
+    };
+
+    static const int SDF_SCALE = 4;    // atlas texels per source pixel
+    static const int SDF_COLUMNS = 16; // glyph cells per atlas row
+    static const int SDF_ROWS = 6;
+    static constexpr float SDF_SPREAD = 2.0f; // distance in source pixels mapped to the full alpha range
+
+    GlyphCache glyphCache; // UTF-8 text goes through here, glyphs are uploaded on first use
+    int symW, symH;
+    GLuint sheetTexture; // the whole sheet, for labels laid out at compile time
+
+    GLuint sdfTexture; // one atlas with all 95 glyphs as signed distance in alpha
+    GLuint sdfProgram; // smoothstep shader, 0 means the alpha test fallback is used
+    GLint sdfSmoothingUniform;
+    int sdfSymW, sdfSymH;
+    bool sdfRequested;
+
+    FrameArena *arena; // per-frame strings come from here when set
+    char intBuffer[12]; // fallback for myIntToStr without an arena
 
     FontRenderer();
 
-    void createPrintableAsciiCharsTexturesFromPng(const char *filename, int symW, int symH);
+    void loadPrintableAsciiCharsFromPng(const char *filename, int symW, int symH);
 
-    SDL_Surface *getPartOfSurfaceAsNewSurface(SDL_Surface *surface, int symW, int symH, int offX, int offY);
+    void loadPrintableAsciiCharsAsync(AssetLoader &loader, const char *filename, int symW, int symH);
 
-    GLuint createTextureFromSurface(SDL_Surface *surface);
+    SDL_Surface *loadFontSheet(const char *filename);
+
+    int uploadLoadedGlyphs(AssetLoader &loader, int maxUploads);
+
+    void loadSdfAtlasAsync(AssetLoader &loader, const char *filename, int symW, int symH);
+
+    SDL_Surface *createSdfAtlasSurface(SDL_Surface *surface, int symW, int symH);
+
+    void createSdfProgram();
 
-    void renderTextureBlock(GLuint texture, float x, float y, float textureWidth, float textureHeight);
+    bool isLoaded();
+
+    void keyBlackAsTransparent(SDL_Surface *surface);
+
+    GLuint createTextureFromSurface(SDL_Surface *surface);
 
     void renderInt(int number, int posX, int posY);
 
     void renderText(const char *str, int posX, int posY);
 
+    void renderTextScaled(const char *str, float posX, float posY, float scale);
+
+    // fixed labels from PixFont::layout, no glyph lookups and one draw call
+    template <int N>
+    void renderQuads(const TextQuads<N> &quads, float posX, float posY)
+    {
+        if (sheetTexture)
+        {
+            quads.render(sheetTexture, posX, posY);
+        }
+    }
+
+    template <int N>
+    void renderQuadsScaled(const TextQuads<N> &quads, float posX, float posY, float scale)
+    {
+        if (!sdfTexture)
+        {
+            return;
+        }
+
+        beginSdf(scale);
+        glPushMatrix();
+        glTranslatef(posX, posY, 0.0f);
+        glScalef(scale, scale, 1.0f);
+        quads.render(sdfTexture, 0.0f, 0.0f);
+        glPopMatrix();
+        endSdf();
+    }
+
+    void beginSdf(float scale);
+
+    void endSdf();
+
     char *myIntToStr(int num);
 
     ~FontRenderer();
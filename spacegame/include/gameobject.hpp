@@ -0,0 +1,41 @@
+#pragma once
+
+class GameObject
+{
+public:
+    float posX, posY;
+    float angle;
+    float velX, velY;
+    float forX, forY;
+    float throttle, rotationThrottle;
+    float mass;
+    float size;
+    float spin; // degrees per tick, asteroids only
+    char status;
+    char ObjectId;
+    char lodStep;  // ticks between updates, more than 1 for objects far from the player
+    char lodPhase; // which of those ticks, fixed at spawn so far objects do not all update together
+    char shape;    // AsteroidMeshes shape index
+    unsigned int lastStepTick; // tick of the last update, a far object moves by the ticks since then
+    GameObject()
+    {
+        posX = posY = 0.0f;
+        angle = 0.0f;
+        velX = velY = 0.0f;
+        forX = forY = 0.0f;
+        throttle = rotationThrottle = 0.0f;
+        mass = 1.0f;
+        size = 0.0f;
+        spin = 0.0f;
+        status = 0;
+        ObjectId = 0;
+        lodStep = 1;
+        lodPhase = 0;
+        shape = 0;
+        lastStepTick = 0;
+    }
+    GameObject(char id) : GameObject()
+    {
+        ObjectId = id;
+    }
+};
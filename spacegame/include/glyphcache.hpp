@@ -0,0 +1,85 @@
+#pragma once
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+
+class CachedGlyph
+{
+public:
+    Uint32 codepoint;
+    int page;           // -1 when the slot is free
+    float s0, t0, s1, t1; // texture coordinates in the page, t0 is the top row
+};
+
+class GlyphPage
+{
+public:
+    static const int MAX_SHELVES = 32;
+
+    GLuint texture;
+    Uint32 lastUsed; // use counter of the last draw that touched the page, drives LRU eviction
+    int shelvesCount;
+    int shelfY[MAX_SHELVES], shelfH[MAX_SHELVES], shelfX[MAX_SHELVES];
+    int nextShelfY;
+};
+
+// Codepoint -> glyph lookups go through an open addressing hash table, glyphs are
+// rasterized on first use into shelf-packed atlas pages. Memory is bounded by
+// MAX_PAGES; when all pages are full the least recently used one is recycled.
+class GlyphCache
+{
+public:
+    static const int PAGE_SIZE = 128;
+    static const int MAX_PAGES = 4;
+    static const int MAX_GLYPHS = 512;
+    static const int HASH_SIZE = 1024; // power of two, at most half full
+    static const Uint32 EMPTY_KEY = 0xFFFFFFFF;
+    static const Uint32 REPLACEMENT_CHAR = 0xFFFD;
+
+    GlyphPage pages[MAX_PAGES];
+    int pagesCount;
+
+    CachedGlyph glyphs[MAX_GLYPHS];
+    int freeSlots[MAX_GLYPHS];
+    int freeCount;
+
+    Uint32 hashKeys[HASH_SIZE];
+    Sint16 hashSlots[HASH_SIZE];
+
+    SDL_Surface *source; // RGBA32 sheet with printable ASCII, black already keyed to transparent
+    int symW, symH;
+    Uint32 *glyphPixels; // one glyph cell, reused by every rasterize so misses do not allocate
+    Uint32 useCounter;
+
+    GlyphCache();
+
+    void setSource(SDL_Surface *sheet, int symW, int symH);
+
+    bool hasSource();
+
+    void beginUse();
+
+    const CachedGlyph *lookup(Uint32 codepoint);
+
+    static Uint32 decodeUtf8(const char *&str);
+
+    void destroy();
+
+    ~GlyphCache();
+
+private:
+    int findSlot(Uint32 codepoint);
+
+    void insertSlot(Uint32 codepoint, int slot);
+
+    void eraseSlot(Uint32 codepoint);
+
+    int rasterize(Uint32 codepoint);
+
+    bool allocate(int w, int h, int &page, int &x, int &y);
+
+    bool allocateInPage(int page, int w, int h, int &x, int &y);
+
+    void evictPage(int page);
+
+    void renderGlyphPixels(Uint32 codepoint, Uint32 *pixels);
+};
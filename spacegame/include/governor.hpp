@@ -0,0 +1,86 @@
+#pragma once
+
+// Trades visual and simulation detail for frame time. It keeps a moving average of the work
+// per frame and steps the quality level down while it is over budget, one level at a time,
+// and back up only once there is clear headroom. A level has to last a while before it
+// changes again, so a borderline frame time does not make it flip every frame.
+//
+// Level 0 is full quality. Each level keeps the cuts of the ones before it:
+//   1 fewer debris particles per explosion
+//   2 asteroids outside the view are simulated every few ticks, like distant ones
+//   3 asteroids are drawn as plain quads in one batch
+class QualityGovernor
+{
+public:
+    static const int LEVELS = 4;
+    static const int DEGRADE_HOLD_FRAMES = 30;  // at least half a second between steps down
+    static const int RESTORE_HOLD_FRAMES = 180; // and three seconds of headroom before a step up
+
+    bool isEnabled;
+    float budgetMs;     // target work per frame, waiting for the next frame excluded
+    float estimateMs;   // exponential moving average of the work per frame
+    float smoothing;    // weight of the newest frame in the average
+    float restoreRatio; // headroom needed to step up, as a fraction of the budget
+    int level;
+    int framesAtLevel;
+    int changes;
+
+    QualityGovernor()
+    {
+        isEnabled = 0;
+        budgetMs = 12.0f;
+        estimateMs = 0.0f;
+        smoothing = 0.1f;
+        restoreRatio = 0.6f;
+        level = 0;
+        framesAtLevel = 0;
+        changes = 0;
+    }
+
+    // returns 1 when the level changed
+    bool update(float workMs)
+    {
+        if (!isEnabled)
+        {
+            return 0;
+        }
+
+        estimateMs += (workMs - estimateMs) * smoothing;
+        framesAtLevel++;
+
+        int wanted = level;
+        if (estimateMs > budgetMs && level < LEVELS - 1 && framesAtLevel >= DEGRADE_HOLD_FRAMES)
+        {
+            wanted = level + 1;
+        }
+        else if (estimateMs < budgetMs * restoreRatio && level > 0 && framesAtLevel >= RESTORE_HOLD_FRAMES)
+        {
+            wanted = level - 1;
+        }
+
+        if (wanted == level)
+        {
+            return 0;
+        }
+        level = wanted;
+        framesAtLevel = 0;
+        changes++;
+        return 1;
+    }
+
+    static int debrisPerExplosion(int level)
+    {
+        static const int caps[LEVELS] = {200, 60, 30, 15};
+        return caps[level];
+    }
+
+    static bool simulatesOffscreenCoarsely(int level)
+    {
+        return level >= 2;
+    }
+
+    static bool drawsSimpleAsteroids(int level)
+    {
+        return level >= 3;
+    }
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include "random.hpp"
+
+// Measures input-to-photon latency offscreen. A thread pushes a synthetic key press at a
+// random moment, like a real key that can go down anywhere in a frame, and remembers when.
+// After every frame the game reads back a square of the framebuffer around the ship, and the
+// first frame where it differs from the settled picture ends the measurement. Readback waits
+// for the GPU, so a sample covers events, update, render and GPU execution, but not the swap
+// chain or the display.
+class LatencyProbe
+{
+public:
+    static const int REGION = 64;      // square read around the ship, large enough for its corners
+    static const int MAX_FRAMES = 120; // a press that shows nothing by then counts as missed
+
+    int missed;
+    std::vector<float> latencies; // ms per trial
+    std::vector<int> frames;      // frames rendered per trial until the change showed
+
+    LatencyProbe();
+
+    bool start(int trials);
+
+    // the injector thread presses `key` within the next `windowUs` microseconds
+    void press(SDL_Keycode key, int windowUs);
+
+    void release(SDL_Keycode key);
+
+    // a press is queued or pushed and has not shown yet
+    bool isWaiting();
+
+    // reads the region centred on x, y in framebuffer pixels as the unchanged picture
+    void settle(int x, int y);
+
+    // reads the region again after a frame, returns 1 once the press has shown or was missed
+    bool frameRendered(int x, int y);
+
+    void report(const char *label);
+
+    void reset();
+
+    void stop();
+
+    ~LatencyProbe();
+
+private:
+    std::thread injector;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    SDL_Keycode pendingKey;
+    int pendingDelayUs;
+    bool hasPending, stopping;
+    std::atomic<Uint64> pushedAt; // performance counter when the press was pushed, 0 before
+
+    bool isArmed;
+    int framesSincePress;
+
+    GameRandom rng;
+    std::vector<Uint8> baseline, pixels;
+
+    void injectorLoop();
+
+    void readRegion(int x, int y, std::vector<Uint8> &out);
+
+    static void pushKey(SDL_Keycode key, bool pressed);
+};
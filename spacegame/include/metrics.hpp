@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// No SDL in here, the monitor tool includes this header on its own.
+
+const uint32_t METRICS_MAGIC = 0x524D4753; // "SGMR"
+const uint32_t METRICS_VERSION = 1;
+const int METRICS_CAPACITY = 1024; // records, power of two
+const char *const METRICS_DEFAULT_NAME = "/spacegame_metrics";
+
+class MetricsRecord
+{
+public:
+    uint64_t frame;
+    float frameMs;  // start of this frame to start of the previous one
+    float updateMs; // ProcessEvents + Update
+    float renderMs; // Render including the swap
+    uint32_t entities;
+    uint32_t particles;
+    uint32_t allocations; // heap allocations made during the frame
+};
+
+class MetricsHeader
+{
+public:
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t recordSize;
+    std::atomic<uint64_t> written; // records ever written, the next one goes to written % capacity
+};
+
+// Single producer ring of MetricsRecord in POSIX shared memory (/dev/shm on Linux).
+// The writer never waits: it overwrites the oldest record and publishes the new count.
+// Readers copy records out and then re-check the count to drop any that were overwritten meanwhile.
+class MetricsRing
+{
+public:
+    MetricsHeader *header;
+    MetricsRecord *records;
+    size_t mappedSize;
+    bool isOwner;
+    char name[64];
+
+    MetricsRing();
+
+    bool create(const char *name);
+
+    bool open(const char *name);
+
+    void write(const MetricsRecord &record)
+    {
+        uint64_t index = header->written.load(std::memory_order_relaxed);
+        // the previous count must be visible before any byte of the slot it lets readers flag as stale
+        std::atomic_thread_fence(std::memory_order_release);
+        records[index & (METRICS_CAPACITY - 1)] = record;
+        header->written.store(index + 1, std::memory_order_release);
+    }
+
+    // copies records [from, written) into out, at most max of them; returns the new position.
+    // lost is how many were overwritten before they could be read.
+    uint64_t read(uint64_t from, MetricsRecord *out, int max, int &count, uint64_t &lost);
+
+    void close();
+
+    ~MetricsRing();
+};
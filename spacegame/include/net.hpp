@@ -0,0 +1,192 @@
+#pragma once
+#include <vector>
+#include <netinet/in.h>
+#include <SDL2/SDL.h>
+#include "gameobject.hpp"
+
+const int NET_MAX_CLIENTS = 16;
+const int NET_MAX_ENTITIES = 256; // ships first, then bullets, then asteroids
+const int NET_HISTORY = 64;       // ticks of world state kept as delta baselines
+const int NET_PACKET_SIZE = 4096;
+
+enum NetPacketType
+{
+    NET_HELLO = 1,
+    NET_WELCOME,
+    NET_INPUT,
+    NET_SNAPSHOT
+};
+
+enum NetKeys
+{
+    NET_KEY_UP = 1,
+    NET_KEY_LEFT = 2,
+    NET_KEY_RIGHT = 4,
+    NET_KEY_FIRE = 8
+};
+
+class BitWriter
+{
+public:
+    Uint8 *buffer;
+    int capacity; // bytes
+    int bitPos;
+    bool overflow;
+
+    BitWriter(Uint8 *buffer, int capacity, int startByte);
+
+    void write(Uint32 value, int bits);
+
+    int bytes();
+};
+
+class BitReader
+{
+public:
+    const Uint8 *buffer;
+    int size; // bytes
+    int bitPos;
+    bool overflow;
+
+    BitReader(const Uint8 *buffer, int size, int startByte);
+
+    Uint32 read(int bits);
+};
+
+// what goes over the wire for one entity: positions at 1/8 px, angle in 256 steps
+class NetEntityState
+{
+public:
+    Uint16 x, y;
+    Uint8 angle;
+    Uint8 kind;
+    Uint8 size;
+    Uint8 alive;
+};
+
+class NetWorldState
+{
+public:
+    Uint32 tick; // 0 = empty baseline
+    NetEntityState entities[NET_MAX_ENTITIES];
+
+    void clear();
+};
+
+// Delays and drops outgoing datagrams to emulate a real network on 127.0.0.1.
+class LinkSimulator
+{
+public:
+    int latencyMs, jitterMs, lossPercent;
+
+    LinkSimulator();
+
+    void send(int socketFd, const Uint8 *data, int size, const sockaddr_in &to);
+
+    void flush(int socketFd);
+
+private:
+    class Pending
+    {
+    public:
+        Uint32 deliverAt;
+        sockaddr_in to;
+        std::vector<Uint8> data;
+    };
+
+    std::vector<Pending> pending;
+};
+
+class NetClientSlot
+{
+public:
+    bool connected;
+    sockaddr_in address;
+    Uint8 keys;
+    Uint32 lastInputTick;
+    Uint32 ackTick;
+    int score;
+    Uint64 bytesSent;
+    int snapshotsSent, fullSnapshotsSent;
+};
+
+class NetServer
+{
+public:
+    int socketFd;
+    LinkSimulator link;
+
+    GameObject entities[NET_MAX_ENTITIES];
+    NetClientSlot clients[NET_MAX_CLIENTS];
+    NetWorldState history[NET_HISTORY];
+    Uint32 tick;
+
+    Uint64 tickCounterTotal; // performance counter ticks spent in step + sendSnapshots
+    int ticksRun;
+
+    NetServer();
+
+    bool start(int port);
+
+    int boundPort();
+
+    void receive();
+
+    void step();
+
+    void sendSnapshots();
+
+    void stop();
+
+    ~NetServer();
+
+private:
+    int encodeSnapshot(int clientId, Uint8 *packet);
+
+    void simulate();
+
+    void spawnShip(int clientId);
+
+    void spawnAsteroid(int index);
+
+    void quantize(NetWorldState &state);
+};
+
+class NetClient
+{
+public:
+    int socketFd;
+    sockaddr_in serverAddress;
+    LinkSimulator link;
+
+    int clientId; // -1 until the server says welcome
+    Uint32 inputTick;
+    Uint32 latestTick;
+    NetWorldState history[NET_HISTORY];
+
+    Uint64 bytesReceived;
+    int snapshotsReceived, snapshotsUndecodable;
+
+    NetClient();
+
+    bool connect(const char *host, int port);
+
+    void sendHello();
+
+    void sendInput(Uint8 keys);
+
+    void receive();
+
+    const NetWorldState *state(Uint32 tick);
+
+    void stop();
+
+    ~NetClient();
+
+private:
+    bool decodeSnapshot(const Uint8 *packet, int size);
+};
+
+int runNetServer(int port, int latencyMs, int lossPercent);
+
+int runLoopbackTest(int clientsCount, int seconds, int latencyMs, int lossPercent);
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+
+class OffscreenTarget
+{
+public:
+    static const int QUERY_RING = 4; // timer queries in flight, read back a few frames late so they never stall
+
+    int width, height;
+    GLuint framebuffer;
+    GLuint colorBuffer;
+
+    bool hasTimerQuery;
+    GLuint timerQueries[QUERY_RING];
+    int queriesIssued, queriesRead;
+
+    Uint64 frameStart;
+    std::vector<float> cpuTimes; // ms per frame spent issuing the frame
+    std::vector<float> gpuTimes; // ms per frame spent executing it on the GPU
+
+    OffscreenTarget();
+
+    bool create(int width, int height);
+
+    void bind();
+
+    void beginFrame();
+
+    void endFrame();
+
+    void finish();
+
+    bool dumpPpm(const char *filename);
+
+    void report(const char *name);
+
+    void destroy();
+
+    ~OffscreenTarget();
+
+private:
+    void collectQuery();
+
+    void reportTimes(const char *label, std::vector<float> &times);
+};
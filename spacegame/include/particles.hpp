@@ -0,0 +1,34 @@
+#pragma once
+#include <GL/glew.h>
+
+class ParticleSystem
+{
+public:
+    static const int MAX_PARTICLES = 4096; // multiple of 4 so the SIMD update never runs past the arrays
+
+    // structure of arrays, live particles are always packed in [0, count)
+    alignas(16) float posX[MAX_PARTICLES];
+    alignas(16) float posY[MAX_PARTICLES];
+    alignas(16) float velX[MAX_PARTICLES];
+    alignas(16) float velY[MAX_PARTICLES];
+    alignas(16) float life[MAX_PARTICLES]; // frames left to live
+
+    float vertices[MAX_PARTICLES * 2]; // interleaved x,y for the point batch
+
+    int count;
+    float minX, minY, maxX, maxY; // particles leaving this box die early
+
+    ParticleSystem();
+
+    void setBounds(float minX, float minY, float maxX, float maxY);
+
+    bool emit(float x, float y, float vx, float vy, float lifetime);
+
+    void update();
+
+    void render(float pointSize);
+
+    void clear();
+
+    ~ParticleSystem();
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+// Hardware counters per game phase through Linux perf_event_open, for the calling thread and
+// user space only. Phases are exclusive: enter() closes the current phase and opens the next,
+// which costs one read of the counter group. When the kernel refuses the counters (another OS,
+// perf_event_paranoid, a VM without a PMU) only the time spent in each phase is kept.
+class PerfCounters
+{
+public:
+    enum Phase
+    {
+        WAIT, // frame pacing and everything outside the phases below
+        EVENTS,
+        MOVE,
+        BOUNDS,
+        COLLIDE,
+        CLEANUP,
+        RENDER,
+        SWAP,
+        PHASES
+    };
+
+    enum Counter
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        COUNTERS
+    };
+
+    bool isEnabled;     // enter() does nothing until start()
+    bool hasCounters;   // 0 when only timers are available
+    bool wasMultiplexed; // the group did not run all the time, counts are partial
+
+    int fds[COUNTERS];
+    int groupFd;          // the first counter that opened leads the group
+    int slotOf[COUNTERS]; // position in the group read, -1 when that counter failed to open
+
+    int current;
+    Uint64 phaseStart;
+    Uint64 lastValues[COUNTERS];
+
+    Uint64 times[PHASES];
+    Uint64 counts[PHASES][COUNTERS];
+
+    PerfCounters();
+
+    void start();
+
+    void enter(int phase)
+    {
+        if (isEnabled && phase != current)
+        {
+            switchPhase(phase);
+        }
+    }
+
+    void report(int frames);
+
+    void stop();
+
+    ~PerfCounters();
+
+private:
+    void switchPhase(int phase);
+
+    bool readGroup(Uint64 *values);
+};
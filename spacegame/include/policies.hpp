@@ -0,0 +1,117 @@
+#pragma once
+#include "gameobject.hpp"
+
+// Game-mode policies for the update loops. The mode flags choose one instantiation per tick,
+// so the per-object loops compile without any test of the mode.
+
+// Leaving the world on one side comes back in on the other.
+class WrapBounds
+{
+public:
+    static void ship(GameObject &ship, float worldW, float worldH)
+    {
+        if (ship.posX > worldW)
+        {
+            ship.posX = 0;
+        }
+        if (ship.posX < 0.0f)
+        {
+            ship.posX = worldW;
+        }
+        if (ship.posY > worldH)
+        {
+            ship.posY = 0;
+        }
+        if (ship.posY < 0.0f)
+        {
+            ship.posY = worldH;
+        }
+    }
+
+    // asteroids wrap only once they are out of sight, while still moving outwards
+    static void target(GameObject &target, float worldW, float worldH)
+    {
+        if (target.posX > worldW && target.velX > 0)
+        {
+            target.posX = 0;
+        }
+        if (target.posX < (0.0f - target.size) && target.velX < 0)
+        {
+            target.posX = worldW;
+        }
+        if (target.posY > (worldH - target.size) && target.velY > 0)
+        {
+            target.posY = 0;
+        }
+        if (target.posY < (0.0f - target.size) && target.velY < 0)
+        {
+            target.posY = worldH;
+        }
+    }
+};
+
+// Everything is reflected off the world's edges, MARGIN inside them.
+class BounceBounds
+{
+public:
+    static constexpr float MARGIN = 20.0f;
+
+    static void ship(GameObject &ship, float worldW, float worldH)
+    {
+        bounce(ship, worldW, worldH);
+    }
+
+    static void target(GameObject &target, float worldW, float worldH)
+    {
+        bounce(target, worldW, worldH);
+    }
+
+private:
+    static void bounce(GameObject &object, float worldW, float worldH)
+    {
+        if (object.posX > worldW - MARGIN)
+        {
+            object.posX += 2 * (worldW - MARGIN - object.posX);
+            object.velX = -object.velX;
+        }
+        if (object.posX < MARGIN)
+        {
+            object.posX += 2 * (MARGIN - object.posX);
+            object.velX = -object.velX;
+        }
+        if (object.posY > worldH - MARGIN)
+        {
+            object.posY += 2 * (worldH - MARGIN - object.posY);
+            object.velY = -object.velY;
+        }
+        if (object.posY < MARGIN)
+        {
+            object.posY += 2 * (MARGIN - object.posY);
+            object.velY = -object.velY;
+        }
+    }
+};
+
+// A shot asteroid bursts into debris particles.
+class DebrisExplosion
+{
+public:
+    template <typename Game>
+    static void explode(Game &game, const GameObject &target, int particles)
+    {
+        for (int p = 0; p < particles; p++)
+        {
+            game.spawnAsteroidParticle(target.posX, target.posY);
+        }
+    }
+};
+
+// A shot asteroid just disappears.
+class NoExplosion
+{
+public:
+    template <typename Game>
+    static void explode(Game &, const GameObject &, int)
+    {
+    }
+};
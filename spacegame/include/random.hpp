@@ -0,0 +1,27 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+// xorshift32 with the whole state in one word, so it can be saved and restored with the world
+class GameRandom
+{
+public:
+    Uint32 state;
+
+    GameRandom()
+    {
+        seed(1);
+    }
+
+    void seed(Uint32 value)
+    {
+        state = value ? value : 0x9E3779B9; // zero would get stuck
+    }
+
+    int next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (int)(state & 0x7FFFFFFF);
+    }
+};
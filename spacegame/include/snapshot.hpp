@@ -0,0 +1,109 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include "gameobject.hpp"
+#include "timingwheel.hpp"
+
+// Everything the simulation needs to continue from a tick, plain data only so a
+// save or restore is a handful of memcpys. Debris particles are visual and left out.
+class WorldSnapshot
+{
+public:
+    static const int MAX_TARGETS = 1024; // room for a fully populated large world
+    static const int MAX_TIMERS = 64;
+
+    Uint32 tick;
+    Uint32 rngState;
+    Uint32 looksRngState;
+    int gameState;
+    int score, level, shield;
+    int spacePresses;
+
+    TimingWheel<MAX_TIMERS> timers;
+    int spawnWaveTimer;
+    int simQuality; // QualityGovernor level the simulation ran at
+
+    GameObject ship;
+    GameObject bullet;
+    GameObject targets[MAX_TARGETS];
+    int targetsCount;
+
+    Uint32 checksum() const
+    {
+        // FNV-1a over the fields, padding inside GameObject is not part of the state
+        Uint32 hash = 2166136261u;
+        hashValue(hash, &tick, sizeof(tick));
+        hashValue(hash, &rngState, sizeof(rngState));
+        hashValue(hash, &looksRngState, sizeof(looksRngState));
+        hashValue(hash, &gameState, sizeof(gameState));
+        hashValue(hash, &score, sizeof(score));
+        hashValue(hash, &level, sizeof(level));
+        hashValue(hash, &shield, sizeof(shield));
+        hashValue(hash, &timers, sizeof(timers)); // only 32 bit fields, no padding
+        hashValue(hash, &spawnWaveTimer, sizeof(spawnWaveTimer));
+        hashValue(hash, &simQuality, sizeof(simQuality));
+        hashObject(hash, ship);
+        hashObject(hash, bullet);
+        for (int i = 0; i < targetsCount; i++)
+        {
+            hashObject(hash, targets[i]);
+        }
+        return hash;
+    }
+
+private:
+    static void hashValue(Uint32 &hash, const void *data, int size)
+    {
+        const Uint8 *bytes = static_cast<const Uint8 *>(data);
+        for (int i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    }
+
+    static void hashObject(Uint32 &hash, const GameObject &object)
+    {
+        hashValue(hash, &object.posX, sizeof(object.posX));
+        hashValue(hash, &object.posY, sizeof(object.posY));
+        hashValue(hash, &object.angle, sizeof(object.angle));
+        hashValue(hash, &object.velX, sizeof(object.velX));
+        hashValue(hash, &object.velY, sizeof(object.velY));
+        hashValue(hash, &object.throttle, sizeof(object.throttle));
+        hashValue(hash, &object.rotationThrottle, sizeof(object.rotationThrottle));
+        hashValue(hash, &object.size, sizeof(object.size));
+        hashValue(hash, &object.status, sizeof(object.status));
+        hashValue(hash, &object.ObjectId, sizeof(object.ObjectId));
+        hashValue(hash, &object.lodStep, sizeof(object.lodStep));
+        hashValue(hash, &object.lodPhase, sizeof(object.lodPhase));
+        hashValue(hash, &object.lastStepTick, sizeof(object.lastStepTick));
+        hashValue(hash, &object.spin, sizeof(object.spin));
+        hashValue(hash, &object.shape, sizeof(object.shape));
+    }
+};
+
+// Preallocated slots indexed by tick, keeps the last SLOTS ticks for rollback.
+template <int SLOTS>
+class SnapshotRing
+{
+public:
+    WorldSnapshot slots[SLOTS];
+
+    SnapshotRing()
+    {
+        for (int i = 0; i < SLOTS; i++)
+        {
+            slots[i] = WorldSnapshot();
+            slots[i].tick = 0xFFFFFFFF;
+        }
+    }
+
+    WorldSnapshot &slotFor(Uint32 tick)
+    {
+        return slots[tick % SLOTS];
+    }
+
+    const WorldSnapshot *find(Uint32 tick) const
+    {
+        const WorldSnapshot &slot = slots[tick % SLOTS];
+        return slot.tick == tick ? &slot : nullptr;
+    }
+};
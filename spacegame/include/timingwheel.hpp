@@ -0,0 +1,202 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+// Hierarchical timing wheel counted in simulation ticks. LEVELS wheels of SLOTS slots each,
+// level n slots are SLOTS^n ticks wide, so 4 levels of 64 reach 2^24 ticks (about 77 hours
+// at 60 ticks/s). Scheduling and cancelling are O(1). An advance touches a single slot, and
+// every SLOTS ticks the next level's slot is spread out over the level below.
+//
+// Plain data with a fixed number of timers, so it is copied into world snapshots as is.
+// A timer carries an event id and an int for the owner's handler, no pointers.
+template <int CAPACITY>
+class TimingWheel
+{
+public:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const Uint32 MAX_DELAY = (1u << (LEVELS * SLOT_BITS)) - 1;
+    static const int NONE = -1;
+
+    class Timer
+    {
+    public:
+        Uint32 expires;
+        Sint32 next, prev;
+        Sint32 slot;       // index into heads, NONE while the timer is free
+        Sint32 generation; // part of the handle, a stale handle never cancels a reused timer
+        Sint32 event;
+        Sint32 data;
+    };
+
+    Uint32 now;
+    Sint32 heads[LEVELS * SLOTS];
+    Timer timers[CAPACITY];
+    Sint32 freeList;
+    Sint32 active;
+
+    TimingWheel()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        now = 0;
+        for (int i = 0; i < LEVELS * SLOTS; i++)
+        {
+            heads[i] = NONE;
+        }
+        for (int i = 0; i < CAPACITY; i++)
+        {
+            timers[i] = Timer();
+            timers[i].next = i + 1 < CAPACITY ? i + 1 : NONE;
+            timers[i].prev = NONE;
+            timers[i].slot = NONE;
+        }
+        freeList = 0;
+        active = 0;
+    }
+
+    // fires `delay` ticks from now (at least 1), returns a handle for cancel() or NONE when full
+    int schedule(Uint32 delay, int event, int data)
+    {
+        if (freeList == NONE)
+        {
+            return NONE;
+        }
+
+        int index = freeList;
+        Timer &timer = timers[index];
+        freeList = timer.next;
+
+        delay = delay < 1 ? 1 : (delay > MAX_DELAY ? MAX_DELAY : delay);
+        timer.expires = now + delay;
+        timer.generation = (timer.generation + 1) & 0x7FFF;
+        timer.event = event;
+        timer.data = data;
+        link(index);
+        active++;
+
+        return (timer.generation << 16) | index;
+    }
+
+    bool cancel(int handle)
+    {
+        int index = handle & 0xFFFF;
+        if (handle == NONE || index >= CAPACITY)
+        {
+            return 0;
+        }
+
+        Timer &timer = timers[index];
+        if (timer.slot == NONE || timer.generation != (handle >> 16))
+        {
+            return 0; // already fired or cancelled
+        }
+
+        unlink(index);
+        release(index);
+        return 1;
+    }
+
+    bool isPending(int handle) const
+    {
+        int index = handle & 0xFFFF;
+        return handle != NONE && index < CAPACITY && timers[index].slot != NONE &&
+               timers[index].generation == (handle >> 16);
+    }
+
+    // one tick, calls handler(event, data) for every timer that expires on it;
+    // the handler may schedule and cancel timers freely
+    template <typename Handler>
+    void advance(Handler handler)
+    {
+        now++;
+
+        // when a level wraps, the slot of the level above is due to be spread over it
+        for (int level = 1; level < LEVELS; level++)
+        {
+            if ((now >> ((level - 1) * SLOT_BITS)) & (SLOTS - 1))
+            {
+                break;
+            }
+            cascade(level);
+        }
+
+        int slot = now & (SLOTS - 1);
+        while (heads[slot] != NONE)
+        {
+            int index = heads[slot];
+            int event = timers[index].event;
+            int data = timers[index].data;
+            unlink(index);
+            release(index);
+            handler(event, data);
+        }
+    }
+
+private:
+    void link(int index)
+    {
+        Timer &timer = timers[index];
+        Uint32 delta = timer.expires - now;
+
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= (1u << ((level + 1) * SLOT_BITS)))
+        {
+            level++;
+        }
+        int slot = level * SLOTS + ((timer.expires >> (level * SLOT_BITS)) & (SLOTS - 1));
+
+        timer.slot = slot;
+        timer.prev = NONE;
+        timer.next = heads[slot];
+        if (timer.next != NONE)
+        {
+            timers[timer.next].prev = index;
+        }
+        heads[slot] = index;
+    }
+
+    void unlink(int index)
+    {
+        Timer &timer = timers[index];
+        if (timer.prev != NONE)
+        {
+            timers[timer.prev].next = timer.next;
+        }
+        else
+        {
+            heads[timer.slot] = timer.next;
+        }
+        if (timer.next != NONE)
+        {
+            timers[timer.next].prev = timer.prev;
+        }
+        timer.slot = NONE;
+    }
+
+    void release(int index)
+    {
+        timers[index].next = freeList;
+        timers[index].prev = NONE;
+        freeList = index;
+        active--;
+    }
+
+    void cascade(int level)
+    {
+        int slot = level * SLOTS + ((now >> (level * SLOT_BITS)) & (SLOTS - 1));
+        int index = heads[slot];
+        heads[slot] = NONE;
+
+        // everything here is now less than one slot of this level away, it lands lower down
+        while (index != NONE)
+        {
+            int next = timers[index].next;
+            link(index);
+            index = next;
+        }
+    }
+};
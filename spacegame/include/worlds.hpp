@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <SDL2/SDL.h>
+#include "random.hpp"
+
+const int WORLD_ASTEROIDS = 8; // slots per world, the game never has more than 6 alive
+const int WORLD_OBS_SIZE = 7 + WORLD_ASTEROIDS * 6;
+
+enum WorldActions
+{
+    WORLD_THRUST = 1,
+    WORLD_LEFT = 2,
+    WORLD_RIGHT = 4,
+    WORLD_FIRE = 8
+};
+
+// N independent single player games stepped in lockstep, without windows or GL.
+// Every field is an array indexed by world (asteroids by world * WORLD_ASTEROIDS + slot),
+// so each phase of the step is one loop over all worlds. Rules follow SpaceGame::Update
+// with screen wrap; debris is visual and not simulated.
+class WorldBatch
+{
+public:
+    int count;
+
+    std::vector<float> shipX, shipY, shipAngle, shipVelX, shipVelY, shipThrottle, shipRotation;
+    std::vector<float> bulletX, bulletY, bulletVelX, bulletVelY;
+    std::vector<Uint8> bulletAlive;
+    std::vector<float> asteroidX, asteroidY, asteroidVelX, asteroidVelY, asteroidSize;
+    std::vector<Uint8> asteroidAlive;
+    std::vector<int> score, level, shield;
+    std::vector<GameRandom> rng;
+
+    // step results, valid until the next step
+    std::vector<float> observations; // count * WORLD_OBS_SIZE, positions scaled to 0..1
+    std::vector<float> rewards;      // +1 per asteroid shot, -1 when the game ends
+    std::vector<Uint8> done;         // the episode ended this step and the world was reset
+
+    std::vector<int> lastEpisodeScore;
+    Uint64 episodesFinished;
+
+    WorldBatch();
+
+    void create(int worlds, unsigned int seed, int threadsCount);
+
+    void reset(int world);
+
+    void step(const std::vector<Uint8> &actions);
+
+    void destroy();
+
+    ~WorldBatch();
+
+private:
+    void stepRange(const Uint8 *actions, int begin, int end);
+
+    void spawnAsteroid(int world, int slot);
+
+    void spawnMoreAsteroids(int world);
+
+    void observe(int world);
+
+    void workerLoop(int index);
+
+    std::vector<std::thread> workers;
+    int chunks; // worlds are split into this many ranges, range 0 runs on the caller
+    std::mutex mutex;
+    std::condition_variable wakeUp, finished;
+    const Uint8 *pendingActions;
+    Uint32 generation; // bumped once per step, workers run when they see a new one
+    int busyWorkers;
+    bool stopping;
+};
+
+int runBatchBenchmark(int worlds, int threadsCount, int steps);
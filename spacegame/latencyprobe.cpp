@@ -0,0 +1,195 @@
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include "include/latencyprobe.hpp"
+
+LatencyProbe::LatencyProbe()
+{
+    missed = 0;
+    pendingKey = SDLK_UNKNOWN;
+    pendingDelayUs = 0;
+    hasPending = 0;
+    stopping = 0;
+    pushedAt = 0;
+    isArmed = 0;
+    framesSincePress = 0;
+}
+
+bool LatencyProbe::start(int trials)
+{
+    latencies.reserve(trials);
+    frames.reserve(trials);
+    baseline.resize(REGION * REGION * 4);
+    pixels.resize(REGION * REGION * 4);
+    rng.seed(SDL_GetPerformanceCounter() & 0xFFFFFFFF);
+
+    injector = std::thread(&LatencyProbe::injectorLoop, this);
+    return 1;
+}
+
+void LatencyProbe::press(SDL_Keycode key, int windowUs)
+{
+    pushedAt = 0;
+    isArmed = 1;
+    framesSincePress = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingKey = key;
+        pendingDelayUs = windowUs > 0 ? rng.next() % windowUs : 0;
+        hasPending = 1;
+    }
+    wakeUp.notify_one();
+}
+
+void LatencyProbe::release(SDL_Keycode key)
+{
+    pushKey(key, 0);
+}
+
+bool LatencyProbe::isWaiting()
+{
+    return isArmed;
+}
+
+void LatencyProbe::settle(int x, int y)
+{
+    readRegion(x, y, baseline);
+}
+
+bool LatencyProbe::frameRendered(int x, int y)
+{
+    if (!isArmed)
+    {
+        return 0;
+    }
+
+    // the picture only changes after the push, so a timestamp loaded after the readback is never late
+    readRegion(x, y, pixels);
+    Uint64 at = pushedAt;
+    if (!at)
+    {
+        return 0;
+    }
+    framesSincePress++;
+
+    if (pixels != baseline)
+    {
+        latencies.push_back((float)((SDL_GetPerformanceCounter() - at) * 1000.0 / SDL_GetPerformanceFrequency()));
+        frames.push_back(framesSincePress);
+        isArmed = 0;
+        return 1;
+    }
+    if (framesSincePress >= MAX_FRAMES)
+    {
+        missed++;
+        isArmed = 0;
+        return 1;
+    }
+    return 0;
+}
+
+void LatencyProbe::report(const char *label)
+{
+    std::cout << "  " << label << ": ";
+    if (latencies.empty())
+    {
+        std::cout << "no samples, " << missed << " missed" << std::endl;
+        return;
+    }
+
+    std::vector<float> sorted(latencies);
+    std::sort(sorted.begin(), sorted.end());
+
+    double total = 0;
+    double totalFrames = 0;
+    for (size_t i = 0; i < sorted.size(); i++)
+    {
+        total += sorted[i];
+        totalFrames += frames[i];
+    }
+
+    std::cout << sorted.size() << " presses, ms: min " << sorted.front()
+              << ", avg " << total / sorted.size()
+              << ", p50 " << sorted[sorted.size() / 2]
+              << ", p95 " << sorted[sorted.size() * 95 / 100]
+              << ", max " << sorted.back()
+              << ", frames avg " << totalFrames / sorted.size();
+    if (missed)
+    {
+        std::cout << ", " << missed << " missed";
+    }
+    std::cout << std::endl;
+}
+
+void LatencyProbe::reset()
+{
+    latencies.clear();
+    frames.clear();
+    missed = 0;
+    isArmed = 0;
+}
+
+void LatencyProbe::stop()
+{
+    if (injector.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = 1;
+        }
+        wakeUp.notify_one();
+        injector.join();
+    }
+}
+
+LatencyProbe::~LatencyProbe()
+{
+    stop();
+}
+
+void LatencyProbe::injectorLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (1)
+    {
+        wakeUp.wait(lock, [this] { return stopping || hasPending; });
+        if (stopping)
+        {
+            break;
+        }
+
+        SDL_Keycode key = pendingKey;
+        int delayUs = pendingDelayUs;
+        hasPending = 0;
+        lock.unlock();
+
+        // independent of the game loop, so the press lands anywhere in its frame
+        std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+        pushedAt = SDL_GetPerformanceCounter(); // before the push, the game may see the key right away
+        pushKey(key, 1);
+
+        lock.lock();
+    }
+}
+
+void LatencyProbe::readRegion(int x, int y, std::vector<Uint8> &out)
+{
+    // synchronous on purpose, it returns once the GPU has finished the frame
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(std::max(x - REGION / 2, 0), std::max(y - REGION / 2, 0), REGION, REGION,
+                 GL_RGBA, GL_UNSIGNED_BYTE, out.data());
+}
+
+void LatencyProbe::pushKey(SDL_Keycode key, bool pressed)
+{
+    // SDL_PushEvent is safe from any thread and stamps the event with the current time
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = pressed ? SDL_KEYDOWN : SDL_KEYUP;
+    event.key.state = pressed ? SDL_PRESSED : SDL_RELEASED;
+    event.key.keysym.sym = key;
+    event.key.keysym.scancode = SDL_GetScancodeFromKey(key);
+    SDL_PushEvent(&event);
+}
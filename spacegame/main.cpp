@@ -1,11 +1,39 @@
 #include <iostream>
+#include <vector>
+#include <algorithm>
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #include "include/font.hpp"
+#include "include/gameobject.hpp"
+#include "include/particles.hpp"
+#include "include/offscreen.hpp"
+#include "include/assets.hpp"
+#include "include/net.hpp"
+#include "include/random.hpp"
+#include "include/snapshot.hpp"
+#include "include/worlds.hpp"
+#include "include/arena.hpp"
+#include "include/metrics.hpp"
+#include "include/camera.hpp"
+#include "include/asteroidmesh.hpp"
+#include "include/capture.hpp"
+#include "include/timingwheel.hpp"
+#include "include/perfcounters.hpp"
+#include "include/flightrecorder.hpp"
+#include "include/governor.hpp"
+#include "include/collisions.hpp"
+#include "include/policies.hpp"
+#include "include/latencyprobe.hpp"
 
 const int SCREEN_WIDTH = 800;
 const int SCREEN_HEIGHT = 600;
 
+// HUD labels never change, their quads are built by the compiler
+constexpr auto SHIELD_LABEL = PixFont::layout("Shield: ");
+constexpr auto SCORE_LABEL = PixFont::layout("Score: ");
+constexpr auto LEVEL_LABEL = PixFont::layout("Level: ");
+constexpr auto GAME_OVER_LABEL = PixFont::layout("GAME OVER");
+
 class GameState
 {
 public:
@@ -26,35 +54,136 @@ public:
     }
 };
 
-class GameInput
+class InputEvent
 {
 public:
-    bool keyUp, keyDown, keyLeft, keyRight, keySpace;
-    GameInput() : keyUp(0), keyDown(0), keyLeft(0), keyRight(0), keySpace(0) {}
+    Uint32 timestamp; // SDL ticks when the event was generated
+    SDL_Keycode key;
+    bool pressed;
 };
 
-class GameObject
+class GameInput
 {
 public:
-    float posX, posY;
-    float angle;
-    float velX, velY;
-    float forX, forY;
-    float throttle, rotationThrottle;
-    float mass;
-    float size;
-    char status;
-    char ObjectId;
-    GameObject(char id)
-    {
-        ObjectId = id;
+    static const int MAX_EVENTS = 64;
+
+    bool keyUp, keyDown, keyLeft, keyRight, keySpace; // held during this tick
+    int spacePresses;                                 // presses not yet consumed, kept even if released in the same frame
+    Uint32 heldByEvents;                              // one bit per key, held according to the key events
+
+    InputEvent events[MAX_EVENTS]; // key events queued for the current tick
+    int eventsCount;
+
+    Uint32 latencyTotal, latencyMax; // event timestamp to simulation step, in ms
+    int latencySamples;
+
+    GameInput() : keyUp(0), keyDown(0), keyLeft(0), keyRight(0), keySpace(0), spacePresses(0), heldByEvents(0),
+                  eventsCount(0), latencyTotal(0), latencyMax(0), latencySamples(0) {}
+
+    void beginTick()
+    {
+        eventsCount = 0;
+    }
+
+    void pushEvent(Uint32 timestamp, SDL_Keycode key, bool pressed)
+    {
+        if (eventsCount < MAX_EVENTS)
+        {
+            events[eventsCount].timestamp = timestamp;
+            events[eventsCount].key = key;
+            events[eventsCount].pressed = pressed;
+            eventsCount++;
+        }
+
+        if (pressed && key == SDLK_SPACE)
+        {
+            spacePresses++;
+        }
+
+        if (pressed)
+        {
+            heldByEvents |= keyBit(key);
+        }
+        else
+        {
+            heldByEvents &= ~keyBit(key);
+        }
+    }
+
+    static Uint32 keyBit(SDL_Keycode key)
+    {
+        switch (key)
+        {
+        case SDLK_UP:
+            return 1;
+        case SDLK_DOWN:
+            return 2;
+        case SDLK_LEFT:
+            return 4;
+        case SDLK_RIGHT:
+            return 8;
+        case SDLK_SPACE:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    bool isHeld(SDL_Keycode key)
+    {
+        return (heldByEvents & keyBit(key)) || wasPressed(key);
+    }
+
+    bool wasPressed(SDL_Keycode key)
+    {
+        for (int i = 0; i < eventsCount; i++)
+        {
+            if (events[i].pressed && events[i].key == key)
+            {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    void sampleKeyboard(Uint32 now)
+    {
+        // held state comes straight from SDL, taps shorter than a frame come from the queue;
+        // events pushed by SDL_PushEvent never reach SDL's keyboard state, so those are tracked here
+        const Uint8 *keys = SDL_GetKeyboardState(nullptr);
+        keyUp = keys[SDL_SCANCODE_UP] || isHeld(SDLK_UP);
+        keyDown = keys[SDL_SCANCODE_DOWN] || isHeld(SDLK_DOWN);
+        keyLeft = keys[SDL_SCANCODE_LEFT] || isHeld(SDLK_LEFT);
+        keyRight = keys[SDL_SCANCODE_RIGHT] || isHeld(SDLK_RIGHT);
+        keySpace = keys[SDL_SCANCODE_SPACE] || isHeld(SDLK_SPACE);
+
+        for (int i = 0; i < eventsCount; i++)
+        {
+            Uint32 latency = now - events[i].timestamp;
+            latencyTotal += latency;
+            if (latency > latencyMax)
+            {
+                latencyMax = latency;
+            }
+            latencySamples++;
+        }
+    }
+
+    bool consumeSpacePress()
+    {
+        if (spacePresses > 0)
+        {
+            spacePresses--;
+            return 1;
+        }
+        return 0;
     }
 };
 
 class SpaceGame
 {
 public:
-    bool isRunning, isDebug;
+    bool isRunning, isDebug, isOffscreen;
 
     GameInput input;
     GameState stateController;
@@ -72,8 +201,60 @@ public:
     GameObject *ship;
     GameObject *bullet;
     std::vector<GameObject *> targets;
+    ObjectPool<GameObject, WorldSnapshot::MAX_TARGETS> asteroidPool; // targets point in here
+
+    GameRandom rng; // all gameplay randomness, part of the snapshot so rollbacks replay exactly
+    GameRandom looksRng; // asteroid shapes and spin, kept apart so visuals never change gameplay
+    Uint32 tick;
+    SnapshotRing<16> snapshots;
+
+    // timed gameplay events, advanced once per tick and part of the snapshot
+    enum TimerEvent
+    {
+        TIMER_SPAWN_WAVE
+    };
+    TimingWheel<WorldSnapshot::MAX_TIMERS> timers;
+    int spawnWaveTimer;
+    static const int SPAWN_WAVE_DELAY = 30; // ticks between losing asteroids and replacing them
+
+    CollisionBuffer<2 * WorldSnapshot::MAX_TARGETS> collisions; // every target hit by the bullet and by the ship
+
+    ParticleSystem debris;
+    GameRandom debrisRng; // debris is visual and not in snapshots, so it has its own sequence
+    AsteroidMeshes asteroidMeshes;
+
+    Camera camera;
+    float lodNearDistance; // targets further than this from the ship are updated every LOD_FAR_STEP ticks
+    static const int LOD_FAR_STEP = 4;
 
     FontRenderer *fontRenderer;
+    AssetLoader assetLoader;
+
+    FrameArena frameArena; // transient per-frame data, reset after every Render
+    Uint64 frameAllocations; // heap allocations in frames after the first one
+    int framesCounted;
+
+    MetricsRing metrics; // written once per frame when created, see monitor.cpp
+    FrameCapture capture;
+    PerfCounters perf; // hardware counters per phase when started, reported at exit
+    FlightRecorder flightRecorder; // last frames, dumped when one goes over budget
+
+    // the governor reacts to frame times; the level the simulation runs at is part of
+    // the world state instead, so snapshots and flight dumps replay the same way
+    QualityGovernor governor;
+    int simQuality;
+    const char *capturePath; // record every rendered frame when set
+    Uint64 lastFrameStart;
+    Uint64 renderSubmitted; // when Render had issued everything, before the swap may block on vsync
+
+    // static screens are drawn once and then only when something on them changes
+    static const int IDLE_WAIT_MS = 250;
+    bool redrawRequested;
+    int renderedState;
+    int idleWaits;
+
+    Uint64 startCounter; // startup instrumentation, all in ms since the game object was created
+    float timeToWindow, timeToFirstFrame, timeToFonts;
 
     int score;
     int level;
@@ -82,12 +263,28 @@ public:
     bool allowScreenBounce;
     bool allowAsteroidExplode;
 
-    SpaceGame()
+    SpaceGame(unsigned int seed)
     {
-        srand(time(0));
+        startCounter = SDL_GetPerformanceCounter();
+        timeToWindow = 0;
+        timeToFirstFrame = 0;
+        timeToFonts = 0;
+
+        rng.seed(seed);
+        looksRng.seed(seed ^ 0x85EBCA6B); // its own sequence, shapes must not mirror gameplay draws
+        debrisRng.seed(~seed);
+        simQuality = 0;
+        flightRecorder.seed = seed;
+        flightRecorder.worldW = SCREEN_WIDTH;
+        flightRecorder.worldH = SCREEN_HEIGHT;
+        tick = 0;
+        spawnWaveTimer = timers.NONE;
+
+        asteroidMeshes.generate(1);
 
         isDebug = 0;
         isRunning = 0;
+        isOffscreen = 0;
         allowScreenBounce = 0;
         allowAsteroidExplode = 1;
 
@@ -109,72 +306,127 @@ public:
         bullet = new GameObject(2);
         bullet->status = 0;
 
+        camera.setView(SCREEN_WIDTH, SCREEN_HEIGHT);
+        camera.setWorld(SCREEN_WIDTH, SCREEN_HEIGHT);
+        lodNearDistance = 0;
+
+        targets.reserve(WorldSnapshot::MAX_TARGETS);
         spawnAsteroid();
 
         score = 0;
         level = 1;
         shield = 3;
 
+        frameArena.create(16 * 1024);
+        frameAllocations = 0;
+        framesCounted = 0;
+        lastFrameStart = 0;
+        renderSubmitted = 0;
+        capturePath = nullptr;
+
+        redrawRequested = 1;
+        renderedState = -1;
+        idleWaits = 0;
+
         fontRenderer = new FontRenderer();
+        fontRenderer->arena = &frameArena;
 
         stateController.setState(PLAYING);
     }
 
+    void setWorldSize(float width, float height)
+    {
+        camera.setWorld(std::max(width, camera.viewW), std::max(height, camera.viewH));
+        flightRecorder.worldW = camera.worldW;
+        flightRecorder.worldH = camera.worldH;
+        debris.setBounds(0.0f, 0.0f, camera.worldW, camera.worldH);
+
+        // anything that can be on screen or touch the ship stays at full rate
+        lodNearDistance = sqrt(camera.viewW * camera.viewW + camera.viewH * camera.viewH) + 100.0f;
+
+        ship->posX = camera.worldW / 2;
+        ship->posY = camera.worldH / 2;
+        camera.follow(ship->posX, ship->posY);
+        spawnMoreAsteroids();
+    }
+
+    bool isWorldLargerThanView()
+    {
+        return camera.worldW > camera.viewW || camera.worldH > camera.viewH;
+    }
+
     void spawnAsteroidParticle(float posX, float posY)
     {
-        GameObject *asteroid;
-        asteroid = new GameObject(4);
-        asteroid->status = 1;
-        asteroid->posX = posX;
-        asteroid->posY = posY;
-        int mlt = 1;
-        if (rand() % 2)
-        {
-            mlt = -1;
-        }
-        asteroid->velX = mlt * (100 + (float)(rand() % 100)) / 100.0f;
-        mlt = 1;
-        if (rand() % 2)
-        {
-            mlt = -1;
-        }
-        asteroid->velY = mlt * (100 + (float)(rand() % 100)) / 100.0f;
-        asteroid->size = 5;
-        targets.push_back(asteroid);
+        // debris is visual only, it lives in the particle system and never touches targets
+        float dir = deg2rad((float)(debrisRng.next() % 360));
+        float speed = (50 + (float)(debrisRng.next() % 150)) / 100.0f;
+        float lifetime = (float)(40 + debrisRng.next() % 60);
+        debris.emit(posX, posY, speed * cos(dir), speed * sin(dir), lifetime);
     }
 
     void spawnAsteroid()
     {
-        GameObject *asteroid;
-        asteroid = new GameObject(3);
+        GameObject *asteroid = asteroidPool.acquire();
+        if (!asteroid)
+        {
+            debugMsg("asteroid pool exhausted");
+            return;
+        }
+        asteroid->ObjectId = 3;
         asteroid->status = 1;
         asteroid->size = getRandomAsteroidSize();
-        int dir = rand() % 4;
+        asteroid->shape = AsteroidMeshes::shapeFor(asteroid->size, looksRng.next());
+        asteroid->spin = ((float)(looksRng.next() % 400) - 200) / 100.0f;
+        asteroid->lodPhase = (char)((tick + targets.size()) % LOD_FAR_STEP);
+        asteroid->lastStepTick = tick;
+
+        int worldW = (int)camera.worldW;
+        int worldH = (int)camera.worldH;
+
+        if (isWorldLargerThanView())
+        {
+            // a large world is populated throughout, but never right in front of the player
+            for (int attempt = 0; attempt < 4; attempt++)
+            {
+                asteroid->posX = (float)(rng.next() % worldW);
+                asteroid->posY = (float)(rng.next() % worldH);
+                if (!camera.isVisible(asteroid->posX, asteroid->posY, asteroid->size * 2))
+                {
+                    break;
+                }
+            }
+            asteroid->velX = ((float)(rng.next() % 600) - 300) / 100.0f;
+            asteroid->velY = ((float)(rng.next() % 600) - 300) / 100.0f;
+            targets.push_back(asteroid);
+            return;
+        }
+
+        int dir = rng.next() % 4;
         switch (dir)
         {
         case 0: // top
-            asteroid->posX = (float)(rand() % 800);
-            asteroid->posY = 600 + asteroid->size;
-            asteroid->velX = ((float)(rand() % 300)) / 100.0f;
-            asteroid->velY = -1 * ((float)(rand() % 300)) / 100.0f;
+            asteroid->posX = (float)(rng.next() % worldW);
+            asteroid->posY = worldH + asteroid->size;
+            asteroid->velX = ((float)(rng.next() % 300)) / 100.0f;
+            asteroid->velY = -1 * ((float)(rng.next() % 300)) / 100.0f;
             break;
         case 1: // left
             asteroid->posX = -1 * asteroid->size;
-            asteroid->posY = (float)(rand() % 600);
-            asteroid->velX = ((float)(rand() % 300)) / 100.0f;
-            asteroid->velY = ((float)(rand() % 300)) / 100.0f;
+            asteroid->posY = (float)(rng.next() % worldH);
+            asteroid->velX = ((float)(rng.next() % 300)) / 100.0f;
+            asteroid->velY = ((float)(rng.next() % 300)) / 100.0f;
             break;
         case 2: // right
-            asteroid->posX = 800 + asteroid->size;
-            asteroid->posY = (float)(rand() % 600);
-            asteroid->velX = -1 * ((float)(rand() % 300)) / 100.0f;
-            asteroid->velY = -1 * ((float)(rand() % 300)) / 100.0f;
+            asteroid->posX = worldW + asteroid->size;
+            asteroid->posY = (float)(rng.next() % worldH);
+            asteroid->velX = -1 * ((float)(rng.next() % 300)) / 100.0f;
+            asteroid->velY = -1 * ((float)(rng.next() % 300)) / 100.0f;
             break;
         case 3: // bottom
-            asteroid->posX = (float)(rand() % 800);
+            asteroid->posX = (float)(rng.next() % worldW);
             asteroid->posY = -1 * asteroid->size;
-            asteroid->velX = ((float)(rand() % 300)) / 100.0f;
-            asteroid->velY = ((float)(rand() % 300)) / 100.0f;
+            asteroid->velX = ((float)(rng.next() % 300)) / 100.0f;
+            asteroid->velY = ((float)(rng.next() % 300)) / 100.0f;
             break;
         default:
             break;
@@ -185,7 +437,7 @@ public:
 
     int getRandomAsteroidSize()
     {
-        switch (rand() % 4)
+        switch (rng.next() % 4)
         {
         case 0:
             return 15;
@@ -201,15 +453,8 @@ public:
 
     void spawnMoreAsteroids()
     {
-        int currentAsteroidsCount = 0;
-
-        for (std::vector<GameObject *>::iterator it = targets.begin(); it != targets.end(); ++it)
-        {
-            if ((*it)->status && (*it)->ObjectId == 3)
-            {
-                currentAsteroidsCount++;
-            }
-        }
+        // destroyed asteroids leave targets at the end of the tick they die in
+        int currentAsteroidsCount = (int)targets.size();
 
         int maxAsteroidsCount = 1;
         if (score <= 3)
@@ -233,30 +478,39 @@ public:
             level = 4;
         }
 
+        // the same density per screen area however big the world is
+        int areaScale = (int)((camera.worldW * camera.worldH) / (camera.viewW * camera.viewH));
+        maxAsteroidsCount = std::min(maxAsteroidsCount * std::max(1, areaScale), WorldSnapshot::MAX_TARGETS);
+
         for (int i = currentAsteroidsCount; i < maxAsteroidsCount; i++)
         {
             spawnAsteroid();
         }
     }
 
-    void run()
+    bool init(bool hidden)
     {
         debugMsg("Starting...");
 
         if (SDL_Init(SDL_INIT_VIDEO) < 0)
         {
             debugMsg("SDL init problem");
-            return;
+            return 0;
         }
 
-        window = SDL_CreateWindow("Space Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
+        filterEvents();
+
+        Uint32 windowFlags = SDL_WINDOW_OPENGL | (hidden ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN);
+        window = SDL_CreateWindow("Space Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, windowFlags);
         if (!window)
         {
             debugMsg("SDL window create problem");
             SDL_Quit();
-            return;
+            return 0;
         }
 
+        timeToWindow = msSinceStart();
+
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
 
@@ -266,492 +520,765 @@ public:
             debugMsg("OpenGL context create problem");
             SDL_DestroyWindow(window);
             SDL_Quit();
-            return;
+            return 0;
         }
 
-        fontRenderer->createPrintableAsciiCharsTexturesFromPng("pixfont.png", 12, 16);
-
-        isRunning = 1;
-        while (isRunning)
+        if (glewInit() != GLEW_OK)
         {
-            WaitFrame(60);
-            ProcessEvents();
-            Update();
-            Render();
+            debugMsg("GLEW init problem");
+            return 0;
         }
-    }
 
-    void WaitFrame(int fps)
-    {
-        static int nextTick = 0;
-        int thisTick;
+        asteroidMeshes.upload();
 
-        thisTick = SDL_GetTicks();
-        if (thisTick < nextTick)
+        if (capturePath && !capture.create(capturePath, SCREEN_WIDTH, SCREEN_HEIGHT))
         {
-            SDL_Delay(nextTick - thisTick);
+            return 0;
         }
-        nextTick = SDL_GetTicks() + (1000 / fps);
+
+        // glyphs arrive over the next frames, text simply stays blank until they do
+        fontRenderer->loadPrintableAsciiCharsAsync(assetLoader, "pixfont.png", PixFont::glyphW, PixFont::glyphH);
+        fontRenderer->loadSdfAtlasAsync(assetLoader, "pixfont.png", PixFont::glyphW, PixFont::glyphH);
+
+        return 1;
     }
 
-    void ProcessEvents()
+    float msSinceStart()
     {
-        SDL_Event event;
-        while (SDL_PollEvent(&event))
-        {
-            switch (event.type)
-            {
-            case SDL_QUIT:
-                isRunning = 0;
-                break;
-
-            case SDL_KEYDOWN:
-                switch (event.key.keysym.sym)
-                {
-                case SDLK_ESCAPE:
-                    isRunning = 0;
-                    break;
-                case SDLK_UP:
-                    input.keyUp = 1;
-                    break;
-                case SDLK_DOWN:
-                    input.keyDown = 1;
-                    break;
-                case SDLK_LEFT:
-                    input.keyLeft = 1;
-                    break;
-                case SDLK_RIGHT:
-                    input.keyRight = 1;
-                    break;
-                case SDLK_SPACE:
-                    input.keySpace = 1;
-                    break;
-                default:
-                    // std::cout << "SDL_KEYDOWN for : " << event.key.keysym.sym << std::endl;
-                    break;
-                }
-                break;
+        return (float)((SDL_GetPerformanceCounter() - startCounter) * 1000.0 / SDL_GetPerformanceFrequency());
+    }
 
-            case SDL_KEYUP:
-                switch (event.key.keysym.sym)
-                {
-                case SDLK_ESCAPE:
-                    isRunning = 0;
-                    break;
-                case SDLK_UP:
-                    input.keyUp = 0;
-                    break;
-                case SDLK_DOWN:
-                    input.keyDown = 0;
-                    break;
-                case SDLK_LEFT:
-                    input.keyLeft = 0;
-                    break;
-                case SDLK_RIGHT:
-                    input.keyRight = 0;
-                    break;
-                case SDLK_SPACE:
-                    input.keySpace = 0;
-                    break;
-                default:
-                    // std::cout << "SDL_KEYUP for : " << event.key.keysym.sym << std::endl;
-                    break;
-                }
-                break;
-            default:
-                break;
-            }
+    bool UploadAssets()
+    {
+        int uploads = fontRenderer->isLoaded() ? 0 : fontRenderer->uploadLoadedGlyphs(assetLoader, 32);
+        if (uploads && fontRenderer->isLoaded())
+        {
+            timeToFonts = msSinceStart();
+            reportStartup();
         }
+        return uploads > 0;
     }
 
-    float deg2rad(float deg)
+    bool isIdle()
     {
-        return deg * M_PI / 180.0f;
+        // the game over screen only changes on input, once it is drawn there is nothing to do
+        return stateController.isInState(GAME_OVER) && renderedState == GAME_OVER && !redrawRequested;
     }
 
-    float rad2deg(float rad)
+    void reportStartup()
     {
-        return rad * 180.0f / M_PI;
+        // called when either milestone is reached, prints once both are known
+        if (isDebug && timeToFirstFrame && timeToFonts)
+        {
+            std::cout << "startup: window " << timeToWindow << " ms, first frame " << timeToFirstFrame
+                      << " ms, fonts " << timeToFonts << " ms" << std::endl;
+        }
     }
 
-    void Update()
+    void run()
     {
+        if (!init(0))
+        {
+            return;
+        }
 
-        if (stateController.isInState(PLAYING))
+        isRunning = 1;
+        while (isRunning)
         {
-            static const float forceFactor = 0.02f;
-            static const float maxMainThrottle = 5.0f;
-            static const float maxRotationThrottle = 3.0f;
+            if (isIdle())
+            {
+                // sleep in the event queue until input arrives, the timeout keeps asset loading going
+                SDL_WaitEventTimeout(nullptr, IDLE_WAIT_MS);
+                idleWaits++;
+            }
+            else
+            {
+                WaitFrame(60);
+            }
 
-            ship->forX = 0;
-            ship->forY = 0;
+            Uint64 frameStart = SDL_GetPerformanceCounter();
+            Uint64 allocationsBefore = heapAllocations();
 
-            // move forward
+            perf.enter(PerfCounters::EVENTS);
+            ProcessEvents(); // drains the queue and samples the keyboard right before the simulation step
 
-            if (input.keyUp)
+            FlightRecord &flight = flightRecorder.next();
+            recordFlightInput(flight);
+            if (flightRecorder.isKeyframeTick(tick))
             {
-                // debugMsg("Up");
-
-                if (ship->throttle < maxMainThrottle)
-                {
-                    ship->throttle += 0.5;
-                }
-
-                ship->forX += ship->throttle * cos(deg2rad(ship->angle));
-                ship->forY += ship->throttle * sin(deg2rad(ship->angle));
+                saveSnapshot(flightRecorder.keyframeFor(tick));
             }
 
-            // change angle
-
-            if (input.keyLeft)
+            Update();
+            Uint64 updated = SDL_GetPerformanceCounter();
+            perf.enter(PerfCounters::RENDER);
+            if (UploadAssets())
             {
-                // debugMsg("Left");
-
-                if (ship->rotationThrottle < maxRotationThrottle)
-                {
-                    ship->rotationThrottle += 0.05;
-                }
-
-                ship->angle += ship->rotationThrottle;
+                redrawRequested = 1;
             }
-            else if (input.keyRight)
+            Uint64 submitted = 0;
+            if (!isIdle())
             {
-                // debugMsg("Right");
+                Render();
+                submitted = renderSubmitted;
+                renderedState = stateController.currentState;
+                redrawRequested = 0;
+            }
+            perf.enter(PerfCounters::WAIT);
+            Uint64 rendered = SDL_GetPerformanceCounter();
+            frameArena.reset();
 
-                if (ship->rotationThrottle < maxRotationThrottle)
-                {
-                    ship->rotationThrottle += 0.05;
-                }
+            // frame work ends before the swap, time blocked on vblank is waiting and not load
+            Uint64 worked = submitted ? submitted : rendered;
 
-                ship->angle -= ship->rotationThrottle;
-            }
-            else
+            if (metrics.header)
             {
-                if (ship->throttle > 0)
-                {
-                    ship->throttle -= 0.2;
-                    if (ship->throttle < 0)
-                    {
-                        ship->throttle = 0;
-                    }
-                }
+                publishMetrics(frameStart, updated, rendered, heapAllocations() - allocationsBefore);
+            }
 
-                if (ship->rotationThrottle > 0)
+            // the next Update runs at whatever level this frame's time calls for
+            if (governor.update((float)((worked - frameStart) * 1000.0 / SDL_GetPerformanceFrequency())))
+            {
+                simQuality = governor.level;
+                if (isDebug)
                 {
-                    ship->rotationThrottle -= 0.1;
-                    if (ship->rotationThrottle < 0)
-                    {
-                        ship->rotationThrottle = 0;
-                    }
+                    std::cout << "quality level " << governor.level << ", frame work estimate " << governor.estimateMs << " ms" << std::endl;
                 }
             }
 
-            ship->velX += ship->forX * forceFactor / ship->mass;
+            if (flightRecorder.isEnabled)
+            {
+                // the first frame pays for startup, it is recorded but never counts as a spike
+                recordFlightFrame(flight, frameStart, updated, worked, heapAllocations() - allocationsBefore);
+                flightRecorder.commit(timeToFirstFrame != 0);
+            }
 
-            if (ship->velX > 3)
+            if (!timeToFirstFrame)
             {
-                ship->velX = 3;
+                timeToFirstFrame = msSinceStart();
+                reportStartup();
             }
-            else if (ship->velX < -3)
+            else
             {
-                ship->velX = -3;
+                // the first frame pays for one-time setup, only later ones count
+                frameAllocations += heapAllocations() - allocationsBefore;
+                framesCounted++;
             }
+        }
 
-            ship->velY += ship->forY * forceFactor / ship->mass;
+        reportInputLatency();
+        reportAllocations();
+        reportCapture();
+        reportQuality();
+        perf.report(framesCounted + 1);
+    }
 
-            if (ship->velY > 3)
+    void reportQuality()
+    {
+        if (governor.isEnabled && (isDebug || governor.changes))
+        {
+            std::cout << "quality: " << governor.changes << " level changes, ended at level " << governor.level
+                      << ", frame work estimate " << governor.estimateMs << " ms of " << governor.budgetMs << " ms budget" << std::endl;
+        }
+    }
+
+    void reportCapture()
+    {
+        if (capture.isActive)
+        {
+            capture.finish();
+            capture.report();
+        }
+    }
+
+    void publishMetrics(Uint64 frameStart, Uint64 updated, Uint64 rendered, Uint64 allocations)
+    {
+        // only stores into shared memory, the monitor process does all the formatting
+        double msPerCount = 1000.0 / SDL_GetPerformanceFrequency();
+
+        MetricsRecord record;
+        record.frame = tick;
+        record.frameMs = lastFrameStart ? (float)((frameStart - lastFrameStart) * msPerCount) : 0;
+        record.updateMs = (float)((updated - frameStart) * msPerCount);
+        record.renderMs = (float)((rendered - updated) * msPerCount);
+        record.entities = (Uint32)targets.size() + 1 + bullet->status;
+        record.particles = (Uint32)debris.count;
+        record.allocations = (Uint32)allocations;
+        metrics.write(record);
+
+        lastFrameStart = frameStart;
+    }
+
+    void recordFlightInput(FlightRecord &record)
+    {
+        record.keys = (input.keyUp ? FLIGHT_KEY_UP : 0) | (input.keyDown ? FLIGHT_KEY_DOWN : 0) |
+                      (input.keyLeft ? FLIGHT_KEY_LEFT : 0) | (input.keyRight ? FLIGHT_KEY_RIGHT : 0);
+        record.spacePresses = input.spacePresses;
+        record.quality = simQuality;
+    }
+
+    void recordFlightFrame(FlightRecord &record, Uint64 frameStart, Uint64 updated, Uint64 worked, Uint64 allocations)
+    {
+        double msPerCount = 1000.0 / SDL_GetPerformanceFrequency();
+
+        record.tick = tick;
+        record.state = stateController.currentState;
+        record.score = score;
+        record.level = level;
+        record.shield = shield;
+        record.targets = (Uint32)targets.size();
+        record.particles = (Uint32)debris.count;
+        record.rngState = rng.state;
+        record.allocations = (Uint32)allocations;
+        record.workMs = (float)((worked - frameStart) * msPerCount);
+        record.updateMs = (float)((updated - frameStart) * msPerCount);
+        record.renderMs = (float)((worked - updated) * msPerCount);
+    }
+
+    // replays a flight dump from its keyframe with the recorded inputs and checks that
+    // every tick ends in the recorded state; headless, Update never touches GL
+    int runReplay(const char *path)
+    {
+        FlightHeader header;
+        if (!flightRecorder.load(path, header))
+        {
+            return 1;
+        }
+
+        std::cout << "replay: seed " << header.seed << ", world " << header.worldW << "x" << header.worldH
+                  << ", spike at tick " << header.spikeTick << ", " << header.recordsCount << " frames" << std::endl;
+        if (!header.snapshotSize)
+        {
+            std::cout << "replay: the dump has no keyframe, the session has to be replayed from the seed" << std::endl;
+            return 1;
+        }
+
+        if (header.worldW > SCREEN_WIDTH || header.worldH > SCREEN_HEIGHT)
+        {
+            setWorldSize(header.worldW, header.worldH);
+        }
+        const WorldSnapshot &keyframe = flightRecorder.keyframes[0];
+        restoreSnapshot(keyframe);
+
+        int replayed = 0;
+        for (Uint32 i = 0; i < header.recordsCount; i++)
+        {
+            const FlightRecord &record = flightRecorder.records[i];
+            if (record.tick <= keyframe.tick)
             {
-                ship->velY = 3;
+                continue;
             }
-            else if (ship->velY < -3)
+
+            input.keyUp = (record.keys & FLIGHT_KEY_UP) != 0;
+            input.keyDown = (record.keys & FLIGHT_KEY_DOWN) != 0;
+            input.keyLeft = (record.keys & FLIGHT_KEY_LEFT) != 0;
+            input.keyRight = (record.keys & FLIGHT_KEY_RIGHT) != 0;
+            input.spacePresses = record.spacePresses;
+            simQuality = record.quality;
+            Update();
+            frameArena.reset();
+
+            if (tick != record.tick || (Uint32)stateController.currentState != record.state || score != record.score ||
+                level != record.level || shield != record.shield || targets.size() != record.targets ||
+                rng.state != record.rngState)
             {
-                ship->velY = -3;
+                std::cout << "replay: diverged at tick " << record.tick << std::endl;
+                return 1;
             }
+            replayed++;
 
-            ship->posX += ship->velX;
-            ship->posY += ship->velY;
+            if (record.tick == header.spikeTick)
+            {
+                std::cout << "replay: spike tick took " << record.workMs << " ms (update " << record.updateMs
+                          << ", render " << record.renderMs << "), " << record.targets << " targets, "
+                          << record.particles << " particles" << std::endl;
+            }
+        }
 
-            // shot
+        std::cout << "replay: " << replayed << " ticks from the keyframe at tick " << keyframe.tick << " match" << std::endl;
+        return 0;
+    }
+
+    int runOffscreen(int frames, const std::vector<int> &dumpFrames)
+    {
+        // hidden window for the context, all drawing goes to a framebuffer object;
+        // with SDL_VIDEODRIVER=offscreen and LIBGL_ALWAYS_SOFTWARE=1 this needs no display or GPU
+        if (!init(1))
+        {
+            return 1;
+        }
 
-            if (input.keySpace)
+        OffscreenTarget target;
+        if (!target.create(SCREEN_WIDTH, SCREEN_HEIGHT))
+        {
+            return 1;
+        }
+        target.cpuTimes.reserve(frames);
+        target.gpuTimes.reserve(frames);
+
+        isOffscreen = 1;
+
+        // every scripted frame must look the same from run to run, so wait for all glyphs first
+        if (!waitForFonts())
+        {
+            return 1;
+        }
+
+        // glyphs are rasterized on first use, after that a frame must not touch the heap
+        static const int warmupFrames = 10;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            Uint64 allocationsBefore = heapAllocations();
+
+            perf.enter(PerfCounters::EVENTS);
+            SDL_PumpEvents();
+            scriptInput(frame);
+            Update();
+
+            target.beginFrame();
+            Render();
+            target.endFrame();
+            perf.enter(PerfCounters::WAIT);
+            frameArena.reset();
+
+            if (frame >= warmupFrames)
             {
-                shotBullet();
-                input.keySpace = 0;
+                frameAllocations += heapAllocations() - allocationsBefore;
+                framesCounted++;
             }
 
-            // move bullet
-
-            if (bullet->status)
+            if (std::find(dumpFrames.begin(), dumpFrames.end(), frame) != dumpFrames.end())
             {
-                bullet->posX += bullet->velX;
-                bullet->posY += bullet->velY;
+                char filename[64];
+                snprintf(filename, sizeof(filename), "spacegame_%05d.ppm", frame);
+                target.dumpPpm(filename);
             }
+        }
 
-            // move targets
+        target.finish();
+        target.report("SpaceGame");
+        reportCapture();
+        perf.report(frames);
+        target.destroy();
 
-            for (std::vector<GameObject *>::iterator it = targets.begin(); it != targets.end(); ++it)
+        // offscreen runs are the regression check for steady-state allocations
+        std::cout << "heap allocations: " << frameAllocations << " in " << framesCounted
+                  << " frames after warm-up, frame arena peak " << frameArena.highWater << " bytes" << std::endl;
+        if (frameAllocations)
+        {
+            std::cout << "FAIL: frames should not allocate from the heap" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    bool waitForFonts()
+    {
+        while (!fontRenderer->isLoaded())
+        {
+            if (!assetLoader.isBusy())
             {
-                if ((*it)->status)
-                {
-                    (*it)->posX += (*it)->velX;
-                    (*it)->posY += (*it)->velY;
-                }
+                debugMsg("font assets missing");
+                return 0;
             }
+            UploadAssets();
+            SDL_Delay(1);
+        }
+        return 1;
+    }
+
+    int runLatencyTest(int trials)
+    {
+        // offscreen like runOffscreen, but the keys come through the SDL event queue like real ones
+        if (!init(1))
+        {
+            return 1;
+        }
+
+        OffscreenTarget target;
+        if (!target.create(SCREEN_WIDTH, SCREEN_HEIGHT))
+        {
+            return 1;
+        }
+
+        isOffscreen = 1;
+        isRunning = 1;
+        if (!waitForFonts())
+        {
+            return 1;
+        }
+
+        // nothing may move but the ship, and that only because of the injected keys
+        while (!targets.empty())
+        {
+            asteroidPool.release(targets.back());
+            targets.pop_back();
+        }
+        debris.clear();
 
-            // bullet out of screen
+        LatencyProbe probe;
+        probe.start(trials);
 
-            if ((bullet->posX > 800.0f) ||
-                (bullet->posX < 0.0f) ||
-                (bullet->posY > 600.0f) ||
-                (bullet->posY < 0.0f))
+        // fire shows on the first tick, so it measures the loop itself; a turn takes a few
+        // ticks of rotation throttle to move the ship's corners by a pixel, as a player sees it
+        static const SDL_Keycode keys[] = {SDLK_SPACE, SDLK_LEFT};
+        static const char *keyNames[] = {"fire", "turn"};
+        static const int paces[] = {60, 30, 0}; // WaitFrame rates, 0 renders as fast as it can
+
+        std::cout << "input to photon latency, " << trials << " presses per key" << std::endl;
+        for (int p = 0; p < 3 && isRunning; p++)
+        {
+            int fps = paces[p];
+            int windowUs = 1000000 / (fps ? fps : 60); // presses land anywhere in a frame
+            if (fps)
             {
-                bullet->status = 0;
+                std::cout << "WaitFrame(" << fps << "):" << std::endl;
+            }
+            else
+            {
+                std::cout << "unpaced:" << std::endl;
             }
 
-            // ship out of screen
-
-            if (allowScreenBounce)
+            for (int k = 0; k < 2 && isRunning; k++)
             {
-                if (ship->posX > 780.0f)
-                {
-                    ship->posX += 2 * (780.0f - ship->posX);
-                    ship->velX = -ship->velX;
-                }
-                if (ship->posX < 20.0f)
+                probe.reset();
+                for (int trial = 0; trial < trials && isRunning; trial++)
                 {
-                    ship->posX += 2 * (20.0f - ship->posX);
-                    ship->velX = -ship->velX;
-                }
-                if (ship->posY > 580.0f)
-                {
-                    ship->posY += 2 * (580.0f - ship->posY);
-                    ship->velY = -ship->velY;
-                }
-                if (ship->posY < 20.0f)
-                {
-                    ship->posY += 2 * (20.0f - ship->posY);
-                    ship->velY = -ship->velY;
+                    // the bullet has to be gone and the ship still before the picture is settled
+                    do
+                    {
+                        latencyFrame(fps);
+                    } while (isRunning && (bullet->status || ship->rotationThrottle > 0));
+                    latencyFrame(fps);
+                    probe.settle(shipScreenX(), shipScreenY());
+
+                    probe.press(keys[k], windowUs);
+                    do
+                    {
+                        latencyFrame(fps);
+                    } while (isRunning && !probe.frameRendered(shipScreenX(), shipScreenY()));
+                    probe.release(keys[k]);
                 }
+                probe.report(keyNames[k]);
             }
-            else
+        }
+
+        probe.stop();
+        target.destroy();
+        return 0;
+    }
+
+    void latencyFrame(int fps)
+    {
+        if (fps)
+        {
+            WaitFrame(fps);
+        }
+        ProcessEvents();
+        Update();
+        Render();
+        frameArena.reset();
+    }
+
+    int shipScreenX()
+    {
+        return (int)(ship->posX - camera.x);
+    }
+
+    int shipScreenY()
+    {
+        return (int)(ship->posY - camera.y);
+    }
+
+    void scriptInput(int frame)
+    {
+        // fixed pattern so every offscreen run with the same seed renders the same frames
+        input.beginTick();
+        input.keyUp = (frame % 120) < 40;
+        input.keyDown = 0;
+        input.keyLeft = (frame % 200) < 50;
+        input.keyRight = 0;
+        input.keySpace = (frame % 20) == 0;
+        if (input.keySpace)
+        {
+            input.spacePresses++;
+        }
+    }
+
+    void filterEvents()
+    {
+        // drop event types the game never reads so they are not queued at all
+        static const Uint32 ignored[] = {
+            SDL_MOUSEMOTION, SDL_MOUSEBUTTONDOWN, SDL_MOUSEBUTTONUP, SDL_MOUSEWHEEL,
+            SDL_FINGERDOWN, SDL_FINGERUP, SDL_FINGERMOTION,
+            SDL_TEXTEDITING, SDL_TEXTINPUT, SDL_KEYMAPCHANGED,
+            SDL_JOYAXISMOTION, SDL_SYSWMEVENT};
+
+        for (unsigned int i = 0; i < sizeof(ignored) / sizeof(ignored[0]); i++)
+        {
+            SDL_EventState(ignored[i], SDL_IGNORE);
+        }
+    }
+
+    void reportInputLatency()
+    {
+        if (isDebug && input.latencySamples)
+        {
+            std::cout << "input events: " << input.latencySamples
+                      << ", avg latency: " << (float)input.latencyTotal / input.latencySamples << " ms"
+                      << ", max latency: " << input.latencyMax << " ms" << std::endl;
+        }
+    }
+
+    void reportAllocations()
+    {
+        if (isDebug && framesCounted)
+        {
+            std::cout << "heap allocations per frame: " << (float)frameAllocations / framesCounted
+                      << ", frame arena peak: " << frameArena.highWater << " bytes"
+                      << ", overflows: " << frameArena.overflows << std::endl;
+        }
+        if (isDebug && idleWaits)
+        {
+            std::cout << "idle waits instead of frames: " << idleWaits << std::endl;
+        }
+    }
+
+    void WaitFrame(int fps)
+    {
+        static int nextTick = 0;
+        int thisTick;
+
+        thisTick = SDL_GetTicks();
+        if (thisTick < nextTick)
+        {
+            SDL_Delay(nextTick - thisTick);
+        }
+        nextTick = SDL_GetTicks() + (1000 / fps);
+    }
+
+    void ProcessEvents()
+    {
+        input.beginTick();
+
+        SDL_Event event;
+        while (SDL_PollEvent(&event))
+        {
+            switch (event.type)
             {
-                if (ship->posX > 800.0f)
+            case SDL_QUIT:
+                isRunning = 0;
+                break;
+
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+                switch (event.key.keysym.sym)
                 {
-                    ship->posX = 0;
+                case SDLK_ESCAPE:
+                    isRunning = 0;
+                    break;
+                case SDLK_UP:
+                case SDLK_DOWN:
+                case SDLK_LEFT:
+                case SDLK_RIGHT:
+                case SDLK_SPACE:
+                    input.pushEvent(event.key.timestamp, event.key.keysym.sym, event.type == SDL_KEYDOWN);
+                    break;
+                default:
+                    // std::cout << "SDL_KEY event for : " << event.key.keysym.sym << std::endl;
+                    break;
                 }
-                if (ship->posX < 0.0f)
+                break;
+
+            case SDL_WINDOWEVENT:
+                if (event.window.event == SDL_WINDOWEVENT_EXPOSED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
                 {
-                    ship->posX = 800;
+                    redrawRequested = 1;
                 }
-                if (ship->posY > 600.0f)
+                break;
+            default:
+                break;
+            }
+        }
+
+        input.sampleKeyboard(SDL_GetTicks());
+    }
+
+    float deg2rad(float deg)
+    {
+        return deg * M_PI / 180.0f;
+    }
+
+    float rad2deg(float rad)
+    {
+        return rad * 180.0f / M_PI;
+    }
+
+    void Update()
+    {
+        tick++;
+        timers.advance([this](int event, int data) { onTimer(event, data); });
+
+        // the bullet lives only inside the view, so the simulation needs the camera too
+        camera.follow(ship->posX, ship->posY);
+
+        if (stateController.isInState(PLAYING))
+        {
+            perf.enter(PerfCounters::MOVE);
+
+            static const float forceFactor = 0.02f;
+            static const float maxMainThrottle = 5.0f;
+            static const float maxRotationThrottle = 3.0f;
+
+            ship->forX = 0;
+            ship->forY = 0;
+
+            // move forward
+
+            if (input.keyUp)
+            {
+                // debugMsg("Up");
+
+                if (ship->throttle < maxMainThrottle)
                 {
-                    ship->posY = 0;
+                    ship->throttle += 0.5;
                 }
-                if (ship->posY < 0.0f)
+
+                ship->forX += ship->throttle * cos(deg2rad(ship->angle));
+                ship->forY += ship->throttle * sin(deg2rad(ship->angle));
+            }
+
+            // change angle
+
+            if (input.keyLeft)
+            {
+                // debugMsg("Left");
+
+                if (ship->rotationThrottle < maxRotationThrottle)
                 {
-                    ship->posY = 600.0f;
+                    ship->rotationThrottle += 0.05;
                 }
+
+                ship->angle += ship->rotationThrottle;
             }
+            else if (input.keyRight)
+            {
+                // debugMsg("Right");
 
-            // targets out of screen
+                if (ship->rotationThrottle < maxRotationThrottle)
+                {
+                    ship->rotationThrottle += 0.05;
+                }
 
-            if (allowScreenBounce)
+                ship->angle -= ship->rotationThrottle;
+            }
+            else
             {
-                for (std::vector<GameObject *>::iterator it = targets.begin(); it != targets.end(); ++it)
+                if (ship->throttle > 0)
                 {
-                    if ((*it)->status)
+                    ship->throttle -= 0.2;
+                    if (ship->throttle < 0)
                     {
-                        if ((*it)->posX > 780.0f)
-                        {
-                            if ((*it)->ObjectId == 4)
-                            {
-                                (*it)->status = 0;
-                            }
-                            else
-                            {
-                                (*it)->posX += 2 * (780.0f - (*it)->posX);
-                                (*it)->velX = -(*it)->velX;
-                            }
-                        }
-                        if ((*it)->posX < 20.0f)
-                        {
-                            if ((*it)->ObjectId == 4)
-                            {
-                                (*it)->status = 0;
-                            }
-                            else
-                            {
-                                (*it)->posX += 2 * (20.0f - (*it)->posX);
-                                (*it)->velX = -(*it)->velX;
-                            }
-                        }
-                        if ((*it)->posY > 580.0f)
-                        {
-                            if ((*it)->ObjectId == 4)
-                            {
-                                (*it)->status = 0;
-                            }
-                            else
-                            {
-                                (*it)->posY += 2 * (580.0f - (*it)->posY);
-                                (*it)->velY = -(*it)->velY;
-                            }
-                        }
-                        if ((*it)->posY < 20.0f)
-                        {
-                            if ((*it)->ObjectId == 4)
-                            {
-                                (*it)->status = 0;
-                            }
-                            else
-                            {
-                                (*it)->posY += 2 * (20.0f - (*it)->posY);
-                                (*it)->velY = -(*it)->velY;
-                            }
-                        }
+                        ship->throttle = 0;
                     }
                 }
-            }
-            else
-            {
-                for (std::vector<GameObject *>::iterator it = targets.begin(); it != targets.end(); ++it)
+
+                if (ship->rotationThrottle > 0)
                 {
-                    if ((*it)->status)
+                    ship->rotationThrottle -= 0.1;
+                    if (ship->rotationThrottle < 0)
                     {
-                        if ((*it)->posX > 800.0f && (*it)->velX > 0)
-                        {
-                            if ((*it)->ObjectId == 4)
-                            {
-                                (*it)->status = 0;
-                            }
-                            (*it)->posX = 0;
-                        }
-                        if ((*it)->posX < (0.0f - (*it)->size) && (*it)->velX < 0)
-                        {
-                            if ((*it)->ObjectId == 4)
-                            {
-                                (*it)->status = 0;
-                            }
-                            (*it)->posX = 800;
-                        }
-                        if ((*it)->posY > (600.0f - (*it)->size) && (*it)->velY > 0)
-                        {
-                            if ((*it)->ObjectId == 4)
-                            {
-                                (*it)->status = 0;
-                            }
-                            (*it)->posY = 0;
-                        }
-                        if ((*it)->posY < (0.0f - (*it)->size) && (*it)->velY < 0)
-                        {
-                            if ((*it)->ObjectId == 4)
-                            {
-                                (*it)->status = 0;
-                            }
-                            (*it)->posY = 600;
-                        }
+                        ship->rotationThrottle = 0;
                     }
                 }
             }
 
-            // bullet vs asteroid
+            ship->velX += ship->forX * forceFactor / ship->mass;
+
+            if (ship->velX > 3)
+            {
+                ship->velX = 3;
+            }
+            else if (ship->velX < -3)
+            {
+                ship->velX = -3;
+            }
+
+            ship->velY += ship->forY * forceFactor / ship->mass;
+
+            if (ship->velY > 3)
+            {
+                ship->velY = 3;
+            }
+            else if (ship->velY < -3)
+            {
+                ship->velY = -3;
+            }
+
+            ship->posX += ship->velX;
+            ship->posY += ship->velY;
+
+            // shot
+
+            if (input.consumeSpacePress())
+            {
+                shotBullet();
+            }
 
-            int particlesNum = 0;
-            float pX, pY;
+            // move bullet
 
             if (bullet->status)
             {
-                for (std::vector<GameObject *>::iterator it = targets.begin(); it != targets.end(); ++it)
-                {
-                    if ((*it)->status)
-                    {
-                        if ((bullet->posX + bullet->size >= (*it)->posX - (*it)->size) &&
-                            (bullet->posX - bullet->size <= (*it)->posX + (*it)->size) &&
-                            (bullet->posY + bullet->size >= (*it)->posY - (*it)->size) &&
-                            (bullet->posY - bullet->size <= (*it)->posY + (*it)->size))
-                        {
-                            score++;
-
-                            bullet->status = 0;
-                            (*it)->status = 0;
-
-                            particlesNum = 2 + rand() % 3;
-                            pX = (*it)->posX;
-                            pY = (*it)->posY;
-                        }
-                    }
-                }
+                bullet->posX += bullet->velX;
+                bullet->posY += bullet->velY;
             }
 
-            if (allowAsteroidExplode)
-            {
-                for (int i = 0; i < particlesNum; i++)
-                {
-                    spawnAsteroidParticle(pX, pY);
-                }
-            }
+            // targets, bounds and collisions, in the loops built for the current game mode
 
-            // ship vs asteroid
+            stepObjects();
 
-            if (ship->status)
+            perf.enter(PerfCounters::CLEANUP);
+
+            // dead targets go back to the pool, the survivors keep their order
+
+            size_t alive = 0;
+            for (size_t i = 0; i < targets.size(); i++)
             {
-                for (std::vector<GameObject *>::iterator it = targets.begin(); it != targets.end(); ++it)
+                if (targets[i]->status)
                 {
-                    if ((*it)->status)
-                    {
-                        if ((ship->posX + ship->size >= (*it)->posX - (*it)->size) &&
-                            (ship->posX - ship->size <= (*it)->posX + (*it)->size) &&
-                            (ship->posY + ship->size >= (*it)->posY - (*it)->size) &&
-                            (ship->posY - ship->size <= (*it)->posY + (*it)->size))
-                        {
-
-                            (*it)->status = 0;
-
-                            if ((*it)->size < 20)
-                            {
-                                shield--;
-                            }
-                            else
-                            {
-                                shield = 0;
-                            }
-
-                            if (shield == 0)
-                            {
-                                ship->status = 0;
-                                stateController.setState(GAME_OVER);
-                            }
-                        }
-                    }
+                    targets[alive++] = targets[i];
+                }
+                else
+                {
+                    asteroidPool.release(targets[i]);
                 }
             }
 
-           
-
-            for (std::vector<GameObject *>::iterator it = targets.begin(); it != targets.end(); ++it)
+            if (alive < targets.size())
             {
-                if (!(*it)->status)
+                targets.resize(alive);
+
+                // losses within one wave window are replaced together
+                if (!timers.isPending(spawnWaveTimer))
                 {
-                    delete *it;
-                    targets.erase(it);
-                    spawnMoreAsteroids();
-                    break;
+                    spawnWaveTimer = timers.schedule(SPAWN_WAVE_DELAY, TIMER_SPAWN_WAVE, 0);
                 }
             }
         }
         else if (stateController.isInState(GAME_OVER))
         {
 
-            if (input.keySpace)
+            if (input.consumeSpacePress())
             {
                 stateController.setState(PLAYING);
-                input.keySpace = 0;
+                input.spacePresses = 0;
                 ship->status = 1;
                 score = 0;
                 level = 1;
                 shield = 3;
-                ship->posX = 400.0f;
-                ship->posY = 100.0f;
+                ship->posX = camera.worldW / 2;
+                ship->posY = camera.worldH / 6;
                 ship->angle = 0.0f;
                 ship->velX = 0.0f;
                 ship->velY = 0.0f;
@@ -764,10 +1291,162 @@ public:
                 {
                    (*it)->status = 0; 
                 }
+
+                debris.clear();
+            }
+        }
+    }
+
+    void stepObjects()
+    {
+        // the only place the mode flags are read, none of the loops below test them
+        if (allowScreenBounce)
+        {
+            if (allowAsteroidExplode)
+            {
+                stepObjects<BounceBounds, DebrisExplosion>();
+            }
+            else
+            {
+                stepObjects<BounceBounds, NoExplosion>();
+            }
+        }
+        else
+        {
+            if (allowAsteroidExplode)
+            {
+                stepObjects<WrapBounds, DebrisExplosion>();
+            }
+            else
+            {
+                stepObjects<WrapBounds, NoExplosion>();
+            }
+        }
+    }
+
+    template <typename Bounds, typename Explosion>
+    void stepObjects()
+    {
+        // move targets, the ones far from the ship only every lodStep ticks but by the ticks
+        // since their last update, so changing lodStep never gains or loses time
+
+        for (size_t i = 0; i < targets.size(); i++)
+        {
+            GameObject *target = targets[i];
+            if (!target->status || (tick + target->lodPhase) % target->lodStep)
+            {
+                continue;
+            }
+
+            float steps = (float)(tick - target->lastStepTick);
+            target->lastStepTick = tick;
+
+            target->posX += target->velX * steps;
+            target->posY += target->velY * steps;
+            target->angle += target->spin * steps;
+
+            float dx = target->posX - ship->posX;
+            float dy = target->posY - ship->posY;
+            bool isFar = lodNearDistance > 0 && dx * dx + dy * dy > lodNearDistance * lodNearDistance;
+
+            // the margin keeps anything the ship or the bullet can touch at full rate
+            bool isHidden = QualityGovernor::simulatesOffscreenCoarsely(simQuality) &&
+                            !camera.isVisible(target->posX, target->posY, target->size + 2 * ship->size);
+            target->lodStep = (isFar || isHidden) ? LOD_FAR_STEP : 1;
+        }
+
+        // move debris
+
+        debris.update();
+
+        perf.enter(PerfCounters::BOUNDS);
+
+        // bullet out of screen
+
+        if (!camera.isVisible(bullet->posX, bullet->posY, 0.0f))
+        {
+            bullet->status = 0;
+        }
+
+        // ship out of screen
+
+        Bounds::ship(*ship, camera.worldW, camera.worldH);
+
+        // targets out of screen
+
+        for (size_t i = 0; i < targets.size(); i++)
+        {
+            if (targets[i]->status)
+            {
+                Bounds::target(*targets[i], camera.worldW, camera.worldH);
+            }
+        }
+
+        perf.enter(PerfCounters::COLLIDE);
+
+        // detection only collects, resolveCollisions applies them all in record order
+
+        collisions.clear();
+        if (bullet->status)
+        {
+            detectCollisions(COLLISION_BULLET, *bullet, targets, 0, targets.size(), collisions);
+        }
+        if (ship->status)
+        {
+            detectCollisions(COLLISION_SHIP, *ship, targets, 0, targets.size(), collisions);
+        }
+        resolveCollisions<Explosion>();
+    }
+
+    template <typename Explosion>
+    void resolveCollisions()
+    {
+        for (int i = 0; i < collisions.count; i++)
+        {
+            const CollisionRecord &record = collisions.records[i];
+            GameObject *target = targets[record.target];
+
+            // a target hit by the bullet and the ship in the same tick counts once, for the first record
+            if (!target->status)
+            {
+                continue;
+            }
+            target->status = 0;
+
+            if (record.kind == COLLISION_BULLET)
+            {
+                score++;
+                bullet->status = 0;
+
+                // drawn even without debris, so the gameplay rng advances the same in every mode
+                int particlesNum = 100 + rng.next() % 100;
+                Explosion::explode(*this, *target, std::min(particlesNum, QualityGovernor::debrisPerExplosion(governor.level)));
+            }
+            else if (record.kind == COLLISION_SHIP)
+            {
+                // small asteroids cost one shield, big ones all of it
+                shield = (target->size < 20 && shield > 0) ? shield - 1 : 0;
+                if (shield == 0 && ship->status)
+                {
+                    ship->status = 0;
+                    stateController.setState(GAME_OVER);
+                }
             }
         }
     }
 
+    void onTimer(int event, int data)
+    {
+        switch (event)
+        {
+        case TIMER_SPAWN_WAVE:
+            spawnMoreAsteroids();
+            break;
+        default:
+            break;
+        }
+    }
+
     void shotBullet()
     {
         if (!bullet->status)
@@ -781,11 +1460,135 @@ public:
         return;
     }
 
+    void saveSnapshot(WorldSnapshot &snapshot)
+    {
+        snapshot.tick = tick;
+        snapshot.rngState = rng.state;
+        snapshot.looksRngState = looksRng.state;
+        snapshot.gameState = stateController.currentState;
+        snapshot.score = score;
+        snapshot.level = level;
+        snapshot.shield = shield;
+        snapshot.spacePresses = input.spacePresses;
+        snapshot.timers = timers;
+        snapshot.spawnWaveTimer = spawnWaveTimer;
+        snapshot.simQuality = simQuality;
+        snapshot.ship = *ship;
+        snapshot.bullet = *bullet;
+
+        int count = 0;
+        for (std::vector<GameObject *>::iterator it = targets.begin(); it != targets.end() && count < WorldSnapshot::MAX_TARGETS; ++it)
+        {
+            snapshot.targets[count++] = **it;
+        }
+        snapshot.targetsCount = count;
+    }
+
+    void restoreSnapshot(const WorldSnapshot &snapshot)
+    {
+        tick = snapshot.tick;
+        rng.state = snapshot.rngState;
+        looksRng.state = snapshot.looksRngState;
+        stateController.setState(snapshot.gameState);
+        score = snapshot.score;
+        level = snapshot.level;
+        shield = snapshot.shield;
+        input.spacePresses = snapshot.spacePresses;
+        timers = snapshot.timers;
+        spawnWaveTimer = snapshot.spawnWaveTimer;
+        simQuality = snapshot.simQuality;
+        *ship = snapshot.ship;
+        *bullet = snapshot.bullet;
+
+        // reuse the objects we have, only a change in count allocates or frees
+        while ((int)targets.size() > snapshot.targetsCount)
+        {
+            asteroidPool.release(targets.back());
+            targets.pop_back();
+        }
+        while ((int)targets.size() < snapshot.targetsCount)
+        {
+            targets.push_back(asteroidPool.acquire());
+        }
+        for (int i = 0; i < snapshot.targetsCount; i++)
+        {
+            *targets[i] = snapshot.targets[i];
+        }
+    }
+
+    void saveTick()
+    {
+        saveSnapshot(snapshots.slotFor(tick));
+    }
+
+    bool rollbackTo(Uint32 toTick)
+    {
+        const WorldSnapshot *snapshot = snapshots.find(toTick);
+        if (!snapshot)
+        {
+            return 0;
+        }
+        restoreSnapshot(*snapshot);
+        return 1;
+    }
+
+    int runSnapshotBenchmark()
+    {
+        // headless, Update never touches GL
+        const int frames = 600;
+        const int rollbackTicks = 8;
+        const int iterations = 100000;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            scriptInput(frame);
+            Update();
+            saveTick();
+        }
+
+        // rollback: resimulating the last ticks with the same input must land on the same state
+        WorldSnapshot live;
+        saveSnapshot(live);
+        rollbackTo(tick - rollbackTicks);
+        for (int frame = frames - rollbackTicks; frame < frames; frame++)
+        {
+            scriptInput(frame);
+            Update();
+        }
+        WorldSnapshot replayed;
+        saveSnapshot(replayed);
+        bool deterministic = live.checksum() == replayed.checksum();
+
+        Uint64 begin = SDL_GetPerformanceCounter();
+        for (int i = 0; i < iterations; i++)
+        {
+            saveSnapshot(snapshots.slots[i % 16]);
+        }
+        Uint64 saved = SDL_GetPerformanceCounter();
+        for (int i = 0; i < iterations; i++)
+        {
+            restoreSnapshot(snapshots.slots[i % 16]);
+        }
+        Uint64 restored = SDL_GetPerformanceCounter();
+
+        double nsPerCount = 1000000000.0 / SDL_GetPerformanceFrequency();
+        std::cout << "snapshot: " << sizeof(WorldSnapshot) << " bytes, " << replayed.targetsCount << " targets" << std::endl;
+        std::cout << "  save " << (saved - begin) * nsPerCount / iterations << " ns, restore "
+                  << (restored - saved) * nsPerCount / iterations << " ns" << std::endl;
+        std::cout << "  rollback of " << rollbackTicks << " ticks " << (deterministic ? "matches" : "DIVERGES") << std::endl;
+
+        return deterministic ? 0 : 1;
+    }
+
     void Render()
     {
+        perf.enter(PerfCounters::RENDER);
+        camera.follow(ship->posX, ship->posY);
+
+        // world pass, the projection is the camera view in world units
         glMatrixMode(GL_PROJECTION);
         glLoadIdentity();
-        glOrtho(0.0f, SCREEN_WIDTH, 0.0f, SCREEN_HEIGHT, -1.0f, 1.0f);
+        glOrtho(camera.x, camera.x + camera.viewW, camera.y, camera.y + camera.viewH, -1.0f, 1.0f);
 
         glClear(GL_COLOR_BUFFER_BIT);
 
@@ -797,6 +1600,17 @@ public:
             renderBullet();
             renderShip();
             renderAsteroids();
+            renderDebris();
+        }
+
+        // screen pass for text
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glOrtho(0.0f, SCREEN_WIDTH, 0.0f, SCREEN_HEIGHT, -1.0f, 1.0f);
+        glMatrixMode(GL_MODELVIEW);
+
+        if (stateController.isInState(PLAYING))
+        {
             renderShield();
             renderScore();
             renderLevel();
@@ -804,19 +1618,39 @@ public:
         else if (stateController.isInState(GAME_OVER))
         {
 
-            renderCentredText("GAME OVER");
+            renderGameOver();
+        }
+
+        // reads the back buffer, or the framebuffer object offscreen, before it is presented
+        if (capture.isActive)
+        {
+            capture.grab();
         }
 
-        SDL_GL_SwapWindow(window);
+        renderSubmitted = SDL_GetPerformanceCounter();
+        if (!isOffscreen)
+        {
+            perf.enter(PerfCounters::SWAP);
+            SDL_GL_SwapWindow(window);
+        }
     }
 
-    void renderCentredText(const char *text)
+    void renderGameOver()
     {
         glPushMatrix();
         glTranslatef(0, 0, 0.0f);
         glColor3f(0.0f, 1.0f, 0.0f);
 
-        fontRenderer->renderText(text, 330, 240);
+        if (fontRenderer->sdfTexture)
+        {
+            float scale = 3.0f;
+            float width = GAME_OVER_LABEL.width * scale;
+            fontRenderer->renderQuadsScaled(GAME_OVER_LABEL, (SCREEN_WIDTH - width) / 2, (SCREEN_HEIGHT - PixFont::glyphH * scale) / 2, scale);
+        }
+        else
+        {
+            fontRenderer->renderQuads(GAME_OVER_LABEL, 330, 240);
+        }
 
         glPopMatrix();
     }
@@ -827,7 +1661,7 @@ public:
         glTranslatef(0, 0, 0.0f);
         glColor3f(0.0f, 1.0f, 0.0f);
 
-        fontRenderer->renderText("Shield: ", 30, 540);
+        fontRenderer->renderQuads(SHIELD_LABEL, 30, 540);
         fontRenderer->renderInt(shield, 130, 540);
 
         glPopMatrix();
@@ -839,7 +1673,7 @@ public:
         glTranslatef(0, 0, 0.0f);
         glColor3f(0.0f, 1.0f, 0.0f);
 
-        fontRenderer->renderText("Score: ", 330, 540);
+        fontRenderer->renderQuads(SCORE_LABEL, 330, 540);
         fontRenderer->renderInt(score, 410, 540);
 
         glPopMatrix();
@@ -851,7 +1685,7 @@ public:
         glTranslatef(0, 0, 0.0f);
         glColor3f(0.0f, 1.0f, 0.0f);
 
-        fontRenderer->renderText("Level: ", 630, 540);
+        fontRenderer->renderQuads(LEVEL_LABEL, 630, 540);
         fontRenderer->renderInt(level, 710, 540);
 
         glPopMatrix();
@@ -880,32 +1714,37 @@ public:
 
     void renderAsteroids()
     {
-        for (std::vector<GameObject *>::iterator it = targets.begin(); it != targets.end(); ++it)
+        glColor3f(0.0f, 1.0f, 1.0f);
+
+        if (QualityGovernor::drawsSimpleAsteroids(governor.level))
         {
-            if ((*it)->status)
+            for (std::vector<GameObject *>::iterator it = targets.begin(); it != targets.end(); ++it)
             {
-                glPushMatrix();
-
-                glTranslatef((*it)->posX, (*it)->posY, 0.0f);
-                glRotatef((*it)->angle, 0.0f, 0.0f, 1.0f);
-                glColor3f(0.0f, 1.0f, 1.0f);
-
-                float rockSize = (*it)->size;
-
-                glBegin(GL_TRIANGLE_STRIP);
+                if ((*it)->status && camera.isVisible((*it)->posX, (*it)->posY, (*it)->size))
                 {
-                    // asteroid body
-                    glVertex2f(0.0f - rockSize, 0.0f - rockSize);
-                    glVertex2f(0.0f + rockSize, 0.0f - rockSize);
-                    glVertex2f(0.0f + rockSize, 0.0f + rockSize);
-                    glVertex2f(0.0f - rockSize, 0.0f + rockSize);
-                    glVertex2f(0.0f - rockSize, 0.0f - rockSize);
+                    asteroidMeshes.addQuad((*it)->posX, (*it)->posY, (*it)->size);
                 }
-                glEnd();
+            }
+            asteroidMeshes.drawQuads();
+            return;
+        }
 
-                glPopMatrix();
+        asteroidMeshes.beginBatch();
+        for (std::vector<GameObject *>::iterator it = targets.begin(); it != targets.end(); ++it)
+        {
+            // outlines reach out to 1.15 times the size
+            if ((*it)->status && camera.isVisible((*it)->posX, (*it)->posY, (*it)->size * 1.5f))
+            {
+                asteroidMeshes.draw((*it)->shape, (*it)->posX, (*it)->posY, (*it)->angle);
             }
         }
+        asteroidMeshes.endBatch();
+    }
+
+    void renderDebris()
+    {
+        glColor3f(0.0f, 1.0f, 1.0f);
+        debris.render(3.0f);
     }
 
     void renderShip()
@@ -952,8 +1791,16 @@ public:
 
     ~SpaceGame()
     {
+        assetLoader.stop();
+
         delete ship;
         delete bullet;
+        targets.clear(); // the asteroids themselves live in asteroidPool
+
+        // before the context goes, it deletes GL objects
+        delete fontRenderer;
+        asteroidMeshes.destroy();
+        capture.destroy();
 
         if (context)
             SDL_GL_DeleteContext(context);
@@ -971,9 +1818,180 @@ public:
     }
 };
 
-int main()
+int main(int argc, char *argv[])
 {
-    SpaceGame game;
-    game.run();
-    return 0;
+    int offscreenFrames = 0;
+    std::vector<int> dumpFrames;
+    bool debug = 0;
+    int serverPort = -1;
+    int loopbackClients = 0;
+    int seconds = 10;
+    int latencyMs = 0;
+    int lossPercent = 0;
+    bool benchSnapshot = 0;
+    int latencyTrials = 0;
+    int batchWorlds = 0;
+    int threadsCount = 1;
+    int steps = 1000;
+    bool publishMetrics = 0;
+    float worldW = SCREEN_WIDTH;
+    float worldH = SCREEN_HEIGHT;
+    const char *capturePath = nullptr;
+    bool perfCounters = 0;
+    float flightBudgetMs = 50.0f;
+    float frameBudgetMs = 0.0f; // the governor changes the simulation, so it only runs when asked for
+    const char *replayPath = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--offscreen") && i + 1 < argc)
+        {
+            offscreenFrames = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--dump") && i + 1 < argc)
+        {
+            dumpFrames.push_back(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--debug"))
+        {
+            debug = 1;
+        }
+        else if (!strcmp(argv[i], "--server") && i + 1 < argc)
+        {
+            serverPort = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--loopback") && i + 1 < argc)
+        {
+            loopbackClients = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc)
+        {
+            seconds = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--latency") && i + 1 < argc)
+        {
+            latencyMs = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--loss") && i + 1 < argc)
+        {
+            lossPercent = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--bench-snapshot"))
+        {
+            benchSnapshot = 1;
+        }
+        else if (!strcmp(argv[i], "--latency-test") && i + 1 < argc)
+        {
+            latencyTrials = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--world") && i + 2 < argc)
+        {
+            worldW = (float)atof(argv[++i]);
+            worldH = (float)atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--capture") && i + 1 < argc)
+        {
+            capturePath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--perf"))
+        {
+            perfCounters = 1;
+        }
+        else if (!strcmp(argv[i], "--flight") && i + 1 < argc)
+        {
+            flightBudgetMs = (float)atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--budget") && i + 1 < argc)
+        {
+            frameBudgetMs = (float)atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+        {
+            replayPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--metrics"))
+        {
+            publishMetrics = 1;
+        }
+        else if (!strcmp(argv[i], "--batch") && i + 1 < argc)
+        {
+            batchWorlds = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+        {
+            threadsCount = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--steps") && i + 1 < argc)
+        {
+            steps = atoi(argv[++i]);
+        }
+    }
+
+    // multiplayer and batch modes are headless and never open a window
+    if (serverPort >= 0)
+    {
+        return runNetServer(serverPort, latencyMs, lossPercent);
+    }
+    if (loopbackClients > 0)
+    {
+        return runLoopbackTest(loopbackClients, seconds, latencyMs, lossPercent);
+    }
+    if (batchWorlds > 0)
+    {
+        return runBatchBenchmark(batchWorlds, threadsCount, steps);
+    }
+
+    Sint64 liveAtStart = heapLiveAllocations();
+    int result = 0;
+    {
+        // offscreen runs use a fixed seed so frame times and dumps are comparable between runs
+        SpaceGame game((offscreenFrames || benchSnapshot) ? 1 : time(0));
+        game.isDebug = debug;
+        game.capturePath = capturePath;
+        game.flightRecorder.isEnabled = flightBudgetMs > 0;
+        game.flightRecorder.budgetMs = flightBudgetMs;
+        game.governor.isEnabled = frameBudgetMs > 0 && !offscreenFrames; // offscreen runs stay comparable
+        game.governor.budgetMs = frameBudgetMs;
+        if (perfCounters)
+        {
+            game.perf.start();
+        }
+        if (worldW > SCREEN_WIDTH || worldH > SCREEN_HEIGHT)
+        {
+            game.setWorldSize(worldW, worldH);
+        }
+        if (publishMetrics)
+        {
+            game.metrics.create(METRICS_DEFAULT_NAME);
+        }
+
+        if (replayPath)
+        {
+            result = game.runReplay(replayPath);
+        }
+        else if (benchSnapshot)
+        {
+            result = game.runSnapshotBenchmark();
+        }
+        else if (latencyTrials > 0)
+        {
+            result = game.runLatencyTest(latencyTrials);
+        }
+        else if (offscreenFrames > 0)
+        {
+            result = game.runOffscreen(offscreenFrames, dumpFrames);
+        }
+        else
+        {
+            game.run();
+        }
+    }
+
+    // everything the game allocated should be gone with it
+    Sint64 leaked = heapLiveAllocations() - liveAtStart;
+    if (leaked && (debug || offscreenFrames))
+    {
+        std::cout << "leaked heap allocations at shutdown: " << leaked << std::endl;
+    }
+    return result;
 }
\ No newline at end of file
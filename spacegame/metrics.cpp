@@ -0,0 +1,151 @@
+
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "include/metrics.hpp"
+
+MetricsRing::MetricsRing()
+{
+    header = nullptr;
+    records = nullptr;
+    mappedSize = sizeof(MetricsHeader) + sizeof(MetricsRecord) * METRICS_CAPACITY;
+    isOwner = 0;
+    name[0] = '\0';
+}
+
+bool MetricsRing::create(const char *name)
+{
+    close();
+
+    // a ring left behind by a crashed run already has a size, and macOS refuses to ftruncate it again
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        std::cout << "metrics: shm_open " << name << " failed: " << strerror(errno) << std::endl;
+        return 0;
+    }
+    if (ftruncate(fd, mappedSize) != 0)
+    {
+        std::cout << "metrics: ftruncate failed: " << strerror(errno) << std::endl;
+        ::close(fd);
+        return 0;
+    }
+
+    void *memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the object alive
+    if (memory == MAP_FAILED)
+    {
+        std::cout << "metrics: mmap failed: " << strerror(errno) << std::endl;
+        return 0;
+    }
+
+    header = (MetricsHeader *)memory;
+    records = (MetricsRecord *)((char *)memory + sizeof(MetricsHeader));
+
+    // a fresh object, a monitor still mapping an earlier run's ring reattaches once that goes quiet
+    header->written.store(0, std::memory_order_relaxed);
+    header->capacity = METRICS_CAPACITY;
+    header->recordSize = sizeof(MetricsRecord);
+    header->version = METRICS_VERSION;
+    header->magic = METRICS_MAGIC;
+
+    isOwner = 1;
+    strncpy(this->name, name, sizeof(this->name) - 1);
+    this->name[sizeof(this->name) - 1] = '\0';
+    return 1;
+}
+
+bool MetricsRing::open(const char *name)
+{
+    close();
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    void *memory = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        return 0;
+    }
+
+    header = (MetricsHeader *)memory;
+    records = (MetricsRecord *)((char *)memory + sizeof(MetricsHeader));
+
+    if (header->magic != METRICS_MAGIC || header->version != METRICS_VERSION ||
+        header->capacity != (uint32_t)METRICS_CAPACITY || header->recordSize != sizeof(MetricsRecord))
+    {
+        std::cout << "metrics: " << name << " has an unknown layout" << std::endl;
+        close();
+        return 0;
+    }
+
+    strncpy(this->name, name, sizeof(this->name) - 1);
+    this->name[sizeof(this->name) - 1] = '\0';
+    return 1;
+}
+
+uint64_t MetricsRing::read(uint64_t from, MetricsRecord *out, int max, int &count, uint64_t &lost)
+{
+    count = 0;
+    lost = 0;
+
+    uint64_t written = header->written.load(std::memory_order_acquire);
+    if (from > written)
+    {
+        from = 0; // the producer restarted
+    }
+    if (written - from > (uint64_t)METRICS_CAPACITY)
+    {
+        lost += written - METRICS_CAPACITY - from;
+        from = written - METRICS_CAPACITY;
+    }
+
+    uint64_t end = from + max < written ? from + max : written;
+    for (uint64_t i = from; i < end; i++)
+    {
+        out[count++] = records[i & (METRICS_CAPACITY - 1)];
+    }
+
+    // anything the writer lapped while we were copying is garbage, including the slot it may be writing now
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t firstSafe = header->written.load(std::memory_order_relaxed) + 1;
+    firstSafe = firstSafe > (uint64_t)METRICS_CAPACITY ? firstSafe - METRICS_CAPACITY : 0;
+    if (firstSafe > from)
+    {
+        int stale = (int)std::min<uint64_t>(firstSafe - from, count);
+        memmove(out, out + stale, (count - stale) * sizeof(MetricsRecord));
+        count -= stale;
+        lost += stale;
+    }
+
+    return end;
+}
+
+void MetricsRing::close()
+{
+    if (header)
+    {
+        munmap(header, mappedSize);
+        header = nullptr;
+        records = nullptr;
+    }
+    if (isOwner)
+    {
+        shm_unlink(name);
+        isOwner = 0;
+    }
+}
+
+MetricsRing::~MetricsRing()
+{
+    close();
+}
@@ -0,0 +1,140 @@
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include "include/metrics.hpp"
+
+// Tails the metrics ring of a running game and prints one aggregated line per interval.
+//   ./monitor.out [--name /spacegame_metrics] [--interval ms]
+
+class MetricsSummary
+{
+public:
+    int frames;
+    double frameMsTotal, updateMsTotal, renderMsTotal;
+    float frameMsMax;
+    uint64_t allocations;
+    uint64_t lost;
+    MetricsRecord last;
+
+    MetricsSummary()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        frames = 0;
+        frameMsTotal = updateMsTotal = renderMsTotal = 0;
+        frameMsMax = 0;
+        allocations = 0;
+        lost = 0;
+        memset(&last, 0, sizeof(last));
+    }
+
+    void add(const MetricsRecord &record)
+    {
+        frames++;
+        frameMsTotal += record.frameMs;
+        updateMsTotal += record.updateMs;
+        renderMsTotal += record.renderMs;
+        frameMsMax = std::max(frameMsMax, record.frameMs);
+        allocations += record.allocations;
+        last = record;
+    }
+
+    void print()
+    {
+        if (!frames)
+        {
+            std::cout << "no frames" << (lost ? ", records lost" : "") << std::endl;
+            return;
+        }
+        std::cout << "frame " << last.frame
+                  << "  fps " << (frameMsTotal > 0 ? 1000.0 * frames / frameMsTotal : 0)
+                  << "  frame avg " << frameMsTotal / frames << " max " << frameMsMax << " ms"
+                  << "  update " << updateMsTotal / frames << " render " << renderMsTotal / frames << " ms"
+                  << "  entities " << last.entities << " particles " << last.particles
+                  << "  allocs " << allocations;
+        if (lost)
+        {
+            std::cout << "  lost " << lost;
+        }
+        std::cout << std::endl;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    const char *name = METRICS_DEFAULT_NAME;
+    int intervalMs = 1000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--name") && i + 1 < argc)
+        {
+            name = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--interval") && i + 1 < argc)
+        {
+            intervalMs = std::max(10, atoi(argv[++i]));
+        }
+    }
+
+    MetricsRing ring;
+    MetricsSummary summary;
+    static MetricsRecord batch[METRICS_CAPACITY];
+    uint64_t position = 0;
+    int idleIntervals = 0;
+    bool waiting = 0;
+
+    while (1)
+    {
+        if (!ring.header)
+        {
+            if (!ring.open(name))
+            {
+                if (!waiting)
+                {
+                    std::cout << "waiting for " << name << " (start the game with --metrics)" << std::endl;
+                    waiting = 1;
+                }
+                usleep(500 * 1000);
+                continue;
+            }
+            waiting = 0;
+            // start from what is already there rather than replaying old frames
+            position = ring.header->written.load();
+            std::cout << "attached to " << name << std::endl;
+        }
+
+        usleep(intervalMs * 1000);
+
+        summary.clear();
+        int count = 0;
+        do
+        {
+            uint64_t lost = 0;
+            position = ring.read(position, batch, METRICS_CAPACITY, count, lost);
+            summary.lost += lost;
+            for (int i = 0; i < count; i++)
+            {
+                summary.add(batch[i]);
+            }
+        } while (count == METRICS_CAPACITY);
+
+        summary.print();
+
+        // a game that exited unlinks the ring, a new one creates another, so reattach after a quiet spell
+        idleIntervals = summary.frames ? 0 : idleIntervals + 1;
+        if (idleIntervals >= 3)
+        {
+            ring.close();
+            idleIntervals = 0;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,1011 @@
+
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include "include/net.hpp"
+
+static const float NET_WORLD_W = 800.0f;
+static const float NET_WORLD_H = 600.0f;
+static const int NET_FIRST_BULLET = NET_MAX_CLIENTS;
+static const int NET_FIRST_ASTEROID = NET_MAX_CLIENTS * 2;
+static const int NET_ASTEROIDS = 12;
+
+static void writeU16(Uint8 *p, Uint16 v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void writeU32(Uint8 *p, Uint32 v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static Uint16 readU16(const Uint8 *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static Uint32 readU32(const Uint8 *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((Uint32)p[3] << 24);
+}
+
+static int openSocket()
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+static bool sameAddress(const sockaddr_in &a, const sockaddr_in &b)
+{
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+static float deg2rad(float deg)
+{
+    return deg * M_PI / 180.0f;
+}
+
+// ---------------------------------------------------------------------------
+
+BitWriter::BitWriter(Uint8 *buffer, int capacity, int startByte)
+{
+    this->buffer = buffer;
+    this->capacity = capacity;
+    bitPos = startByte * 8;
+    overflow = 0;
+    memset(buffer + startByte, 0, capacity - startByte);
+}
+
+void BitWriter::write(Uint32 value, int bits)
+{
+    if (bitPos + bits > capacity * 8)
+    {
+        overflow = 1;
+        return;
+    }
+    for (int i = 0; i < bits; i++, bitPos++)
+    {
+        if (value & (1u << i))
+        {
+            buffer[bitPos >> 3] |= 1 << (bitPos & 7);
+        }
+    }
+}
+
+int BitWriter::bytes()
+{
+    return (bitPos + 7) / 8;
+}
+
+BitReader::BitReader(const Uint8 *buffer, int size, int startByte)
+{
+    this->buffer = buffer;
+    this->size = size;
+    bitPos = startByte * 8;
+    overflow = 0;
+}
+
+Uint32 BitReader::read(int bits)
+{
+    if (bitPos + bits > size * 8)
+    {
+        overflow = 1;
+        return 0;
+    }
+    Uint32 value = 0;
+    for (int i = 0; i < bits; i++, bitPos++)
+    {
+        if (buffer[bitPos >> 3] & (1 << (bitPos & 7)))
+        {
+            value |= 1u << i;
+        }
+    }
+    return value;
+}
+
+void NetWorldState::clear()
+{
+    tick = 0;
+    memset(entities, 0, sizeof(entities));
+}
+
+// ---------------------------------------------------------------------------
+
+LinkSimulator::LinkSimulator()
+{
+    latencyMs = 0;
+    jitterMs = 0;
+    lossPercent = 0;
+}
+
+void LinkSimulator::send(int socketFd, const Uint8 *data, int size, const sockaddr_in &to)
+{
+    if (lossPercent && rand() % 100 < lossPercent)
+    {
+        return;
+    }
+
+    if (!latencyMs && !jitterMs)
+    {
+        sendto(socketFd, data, size, 0, (const sockaddr *)&to, sizeof(to));
+        return;
+    }
+
+    Pending packet;
+    packet.deliverAt = SDL_GetTicks() + latencyMs + (jitterMs ? rand() % (jitterMs + 1) : 0);
+    packet.to = to;
+    packet.data.assign(data, data + size);
+    pending.push_back(packet);
+}
+
+void LinkSimulator::flush(int socketFd)
+{
+    Uint32 now = SDL_GetTicks();
+    size_t kept = 0;
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        if ((Sint32)(now - pending[i].deliverAt) >= 0)
+        {
+            sendto(socketFd, &pending[i].data[0], pending[i].data.size(), 0, (const sockaddr *)&pending[i].to, sizeof(pending[i].to));
+        }
+        else
+        {
+            if (kept != i)
+            {
+                pending[kept] = pending[i];
+            }
+            kept++;
+        }
+    }
+    pending.resize(kept);
+}
+
+// ---------------------------------------------------------------------------
+
+NetServer::NetServer()
+{
+    socketFd = -1;
+    tick = 0;
+    tickCounterTotal = 0;
+    ticksRun = 0;
+
+    memset(clients, 0, sizeof(clients));
+    for (int i = 0; i < NET_HISTORY; i++)
+    {
+        history[i].clear();
+    }
+}
+
+bool NetServer::start(int port)
+{
+    socketFd = openSocket();
+    if (socketFd < 0)
+    {
+        std::cout << "server socket problem" << std::endl;
+        return 0;
+    }
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if (bind(socketFd, (sockaddr *)&address, sizeof(address)) < 0)
+    {
+        std::cout << "server bind problem on port " << port << std::endl;
+        stop();
+        return 0;
+    }
+
+    for (int i = 0; i < NET_ASTEROIDS; i++)
+    {
+        spawnAsteroid(NET_FIRST_ASTEROID + i);
+    }
+    return 1;
+}
+
+int NetServer::boundPort()
+{
+    sockaddr_in address;
+    socklen_t length = sizeof(address);
+    getsockname(socketFd, (sockaddr *)&address, &length);
+    return ntohs(address.sin_port);
+}
+
+void NetServer::receive()
+{
+    Uint8 packet[NET_PACKET_SIZE];
+    sockaddr_in from;
+    socklen_t fromLength = sizeof(from);
+
+    while (1)
+    {
+        int size = recvfrom(socketFd, packet, sizeof(packet), 0, (sockaddr *)&from, &fromLength);
+        if (size <= 0)
+        {
+            return;
+        }
+
+        if (packet[0] == NET_HELLO)
+        {
+            int id = -1;
+            for (int i = 0; i < NET_MAX_CLIENTS && id < 0; i++)
+            {
+                if (clients[i].connected && sameAddress(clients[i].address, from))
+                {
+                    id = i; // welcome got lost, say it again
+                }
+            }
+            for (int i = 0; i < NET_MAX_CLIENTS && id < 0; i++)
+            {
+                if (!clients[i].connected)
+                {
+                    id = i;
+                    memset(&clients[i], 0, sizeof(clients[i]));
+                    clients[i].connected = 1;
+                    clients[i].address = from;
+                    spawnShip(i);
+                }
+            }
+            if (id < 0)
+            {
+                continue; // server full
+            }
+
+            Uint8 welcome[2] = {NET_WELCOME, (Uint8)id};
+            link.send(socketFd, welcome, sizeof(welcome), from);
+        }
+        else if (packet[0] == NET_INPUT && size >= 11)
+        {
+            int id = packet[1];
+            if (id >= NET_MAX_CLIENTS || !clients[id].connected || !sameAddress(clients[id].address, from))
+            {
+                continue;
+            }
+
+            NetClientSlot &client = clients[id];
+            Uint32 inputTick = readU32(packet + 2);
+            Uint32 ackTick = readU32(packet + 6);
+
+            // datagrams can arrive out of order, only newer input counts
+            if (inputTick > client.lastInputTick)
+            {
+                client.lastInputTick = inputTick;
+                client.keys = packet[10];
+            }
+            if (ackTick > client.ackTick && ackTick <= tick)
+            {
+                client.ackTick = ackTick;
+            }
+        }
+    }
+}
+
+void NetServer::spawnShip(int clientId)
+{
+    GameObject &ship = entities[clientId];
+    ship = GameObject(1);
+    ship.posX = (float)(100 + rand() % 600);
+    ship.posY = (float)(100 + rand() % 400);
+    ship.angle = 0.0f;
+    ship.velX = 0.0f;
+    ship.velY = 0.0f;
+    ship.throttle = 0;
+    ship.rotationThrottle = 0;
+    ship.mass = 1.0f;
+    ship.size = 20.0f;
+    ship.status = 1;
+}
+
+void NetServer::spawnAsteroid(int index)
+{
+    // same entry rule as the single player game: come in from a random edge
+    GameObject &asteroid = entities[index];
+    asteroid = GameObject(3);
+    asteroid.status = 1;
+    asteroid.size = (float)(15 + 5 * (rand() % 4));
+    asteroid.angle = 0.0f;
+    switch (rand() % 4)
+    {
+    case 0:
+        asteroid.posX = (float)(rand() % 800);
+        asteroid.posY = NET_WORLD_H + asteroid.size;
+        break;
+    case 1:
+        asteroid.posX = -asteroid.size;
+        asteroid.posY = (float)(rand() % 600);
+        break;
+    case 2:
+        asteroid.posX = NET_WORLD_W + asteroid.size;
+        asteroid.posY = (float)(rand() % 600);
+        break;
+    default:
+        asteroid.posX = (float)(rand() % 800);
+        asteroid.posY = -asteroid.size;
+        break;
+    }
+    asteroid.velX = ((float)(rand() % 600) - 300.0f) / 100.0f;
+    asteroid.velY = ((float)(rand() % 600) - 300.0f) / 100.0f;
+}
+
+static void wrap(GameObject &object)
+{
+    if (object.posX > NET_WORLD_W && object.velX > 0)
+    {
+        object.posX = 0;
+    }
+    if (object.posX < -object.size && object.velX < 0)
+    {
+        object.posX = NET_WORLD_W;
+    }
+    if (object.posY > NET_WORLD_H && object.velY > 0)
+    {
+        object.posY = 0;
+    }
+    if (object.posY < -object.size && object.velY < 0)
+    {
+        object.posY = NET_WORLD_H;
+    }
+}
+
+static bool overlaps(const GameObject &a, const GameObject &b)
+{
+    return (a.posX + a.size >= b.posX - b.size) &&
+           (a.posX - a.size <= b.posX + b.size) &&
+           (a.posY + a.size >= b.posY - b.size) &&
+           (a.posY - a.size <= b.posY + b.size);
+}
+
+void NetServer::simulate()
+{
+    static const float forceFactor = 0.02f;
+    static const float maxMainThrottle = 5.0f;
+    static const float maxRotationThrottle = 3.0f;
+
+    // ships and bullets, driven by the latest input of their client
+    for (int id = 0; id < NET_MAX_CLIENTS; id++)
+    {
+        if (!clients[id].connected)
+        {
+            continue;
+        }
+
+        GameObject &ship = entities[id];
+        GameObject &bullet = entities[NET_FIRST_BULLET + id];
+        Uint8 keys = clients[id].keys;
+
+        ship.forX = 0;
+        ship.forY = 0;
+
+        if (keys & NET_KEY_UP)
+        {
+            if (ship.throttle < maxMainThrottle)
+            {
+                ship.throttle += 0.5;
+            }
+            ship.forX += ship.throttle * cos(deg2rad(ship.angle));
+            ship.forY += ship.throttle * sin(deg2rad(ship.angle));
+        }
+
+        if (keys & (NET_KEY_LEFT | NET_KEY_RIGHT))
+        {
+            if (ship.rotationThrottle < maxRotationThrottle)
+            {
+                ship.rotationThrottle += 0.05;
+            }
+            ship.angle += (keys & NET_KEY_LEFT) ? ship.rotationThrottle : -ship.rotationThrottle;
+        }
+        else
+        {
+            ship.throttle = ship.throttle > 0.2f ? ship.throttle - 0.2f : 0;
+            ship.rotationThrottle = ship.rotationThrottle > 0.1f ? ship.rotationThrottle - 0.1f : 0;
+        }
+
+        ship.velX = std::max(-3.0f, std::min(3.0f, ship.velX + ship.forX * forceFactor / ship.mass));
+        ship.velY = std::max(-3.0f, std::min(3.0f, ship.velY + ship.forY * forceFactor / ship.mass));
+        ship.posX += ship.velX;
+        ship.posY += ship.velY;
+        wrap(ship);
+
+        if ((keys & NET_KEY_FIRE) && !bullet.status)
+        {
+            bullet = GameObject(2);
+            bullet.status = 1;
+            bullet.size = 2.0f;
+            bullet.posX = ship.posX;
+            bullet.posY = ship.posY;
+            bullet.velX = 10.0f * cos(deg2rad(ship.angle));
+            bullet.velY = 10.0f * sin(deg2rad(ship.angle));
+        }
+
+        if (bullet.status)
+        {
+            bullet.posX += bullet.velX;
+            bullet.posY += bullet.velY;
+            if (bullet.posX > NET_WORLD_W || bullet.posX < 0.0f || bullet.posY > NET_WORLD_H || bullet.posY < 0.0f)
+            {
+                bullet.status = 0;
+            }
+        }
+    }
+
+    for (int i = NET_FIRST_ASTEROID; i < NET_FIRST_ASTEROID + NET_ASTEROIDS; i++)
+    {
+        GameObject &asteroid = entities[i];
+        asteroid.posX += asteroid.velX;
+        asteroid.posY += asteroid.velY;
+        wrap(asteroid);
+
+        for (int id = 0; id < NET_MAX_CLIENTS; id++)
+        {
+            if (!clients[id].connected)
+            {
+                continue;
+            }
+
+            GameObject &bullet = entities[NET_FIRST_BULLET + id];
+            if (bullet.status && overlaps(bullet, asteroid))
+            {
+                bullet.status = 0;
+                clients[id].score++;
+                spawnAsteroid(i);
+                break;
+            }
+
+            if (overlaps(entities[id], asteroid))
+            {
+                clients[id].score = 0;
+                spawnShip(id);
+                spawnAsteroid(i);
+                break;
+            }
+        }
+    }
+}
+
+void NetServer::quantize(NetWorldState &state)
+{
+    state.tick = tick;
+    for (int i = 0; i < NET_MAX_ENTITIES; i++)
+    {
+        const GameObject &object = entities[i];
+        NetEntityState &out = state.entities[i];
+
+        bool owned = i < NET_FIRST_ASTEROID;
+        bool connected = owned && clients[i % NET_MAX_CLIENTS].connected;
+        if (!object.status || (owned && !connected))
+        {
+            memset(&out, 0, sizeof(out));
+            continue;
+        }
+
+        float angle = fmodf(object.angle, 360.0f);
+        if (angle < 0)
+        {
+            angle += 360.0f;
+        }
+
+        // offset by 64 px so objects entering from outside the screen still fit 13 bits
+        out.x = (Uint16)std::max(0.0f, std::min(8191.0f, (object.posX + 64.0f) * 8.0f));
+        out.y = (Uint16)std::max(0.0f, std::min(8191.0f, (object.posY + 64.0f) * 8.0f));
+        out.angle = (Uint8)(angle * 256.0f / 360.0f);
+        out.kind = object.ObjectId & 3;
+        out.size = (Uint8)std::min(63.0f, object.size);
+        out.alive = 1;
+    }
+}
+
+void NetServer::step()
+{
+    Uint64 begin = SDL_GetPerformanceCounter();
+
+    simulate();
+    tick++;
+    quantize(history[tick % NET_HISTORY]);
+
+    tickCounterTotal += SDL_GetPerformanceCounter() - begin;
+}
+
+int NetServer::encodeSnapshot(int clientId, Uint8 *packet)
+{
+    static NetWorldState empty;
+    static bool emptyReady = 0;
+    if (!emptyReady)
+    {
+        empty.clear();
+        emptyReady = 1;
+    }
+
+    NetClientSlot &client = clients[clientId];
+    const NetWorldState &current = history[tick % NET_HISTORY];
+
+    // delta against the newest state the client confirmed, or everything if that is gone
+    const NetWorldState *base = &empty;
+    Uint32 ack = client.ackTick;
+    if (ack && tick - ack < NET_HISTORY && history[ack % NET_HISTORY].tick == ack)
+    {
+        base = &history[ack % NET_HISTORY];
+    }
+
+    packet[0] = NET_SNAPSHOT;
+    writeU32(packet + 1, tick);
+    writeU32(packet + 5, base->tick);
+    writeU16(packet + 9, (Uint16)client.score);
+
+    BitWriter writer(packet, NET_PACKET_SIZE, 13);
+    int records = 0;
+
+    for (int i = 0; i < NET_MAX_ENTITIES; i++)
+    {
+        const NetEntityState &now = current.entities[i];
+        const NetEntityState &was = base->entities[i];
+
+        if (!now.alive)
+        {
+            if (was.alive)
+            {
+                writer.write(i, 8);
+                writer.write(1, 1); // removed
+                records++;
+            }
+            continue;
+        }
+
+        int mask = 7;
+        if (was.alive)
+        {
+            mask = 0;
+            mask |= (now.x != was.x || now.y != was.y) ? 1 : 0;
+            mask |= (now.angle != was.angle) ? 2 : 0;
+            mask |= (now.kind != was.kind || now.size != was.size) ? 4 : 0;
+        }
+        if (!mask)
+        {
+            continue;
+        }
+
+        writer.write(i, 8);
+        writer.write(0, 1);
+        writer.write(mask, 3);
+        if (mask & 1)
+        {
+            writer.write(now.x, 13);
+            writer.write(now.y, 13);
+        }
+        if (mask & 2)
+        {
+            writer.write(now.angle, 8);
+        }
+        if (mask & 4)
+        {
+            writer.write(now.kind, 2);
+            writer.write(now.size, 6);
+        }
+        records++;
+    }
+
+    writeU16(packet + 11, (Uint16)records);
+
+    if (base == &empty)
+    {
+        client.fullSnapshotsSent++;
+    }
+    return writer.bytes();
+}
+
+void NetServer::sendSnapshots()
+{
+    Uint64 begin = SDL_GetPerformanceCounter();
+
+    Uint8 packet[NET_PACKET_SIZE];
+    for (int id = 0; id < NET_MAX_CLIENTS; id++)
+    {
+        if (!clients[id].connected)
+        {
+            continue;
+        }
+
+        int size = encodeSnapshot(id, packet);
+        link.send(socketFd, packet, size, clients[id].address);
+        clients[id].bytesSent += size;
+        clients[id].snapshotsSent++;
+    }
+
+    tickCounterTotal += SDL_GetPerformanceCounter() - begin;
+    ticksRun++;
+}
+
+void NetServer::stop()
+{
+    if (socketFd >= 0)
+    {
+        close(socketFd);
+        socketFd = -1;
+    }
+}
+
+NetServer::~NetServer()
+{
+    stop();
+}
+
+// ---------------------------------------------------------------------------
+
+NetClient::NetClient()
+{
+    socketFd = -1;
+    memset(&serverAddress, 0, sizeof(serverAddress));
+    clientId = -1;
+    inputTick = 0;
+    latestTick = 0;
+    bytesReceived = 0;
+    snapshotsReceived = 0;
+    snapshotsUndecodable = 0;
+
+    for (int i = 0; i < NET_HISTORY; i++)
+    {
+        history[i].clear();
+    }
+}
+
+bool NetClient::connect(const char *host, int port)
+{
+    socketFd = openSocket();
+    if (socketFd < 0)
+    {
+        std::cout << "client socket problem" << std::endl;
+        return 0;
+    }
+
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &serverAddress.sin_addr) != 1)
+    {
+        std::cout << "bad server address " << host << std::endl;
+        stop();
+        return 0;
+    }
+
+    sendHello();
+    return 1;
+}
+
+void NetClient::sendHello()
+{
+    Uint8 hello[1] = {NET_HELLO};
+    link.send(socketFd, hello, sizeof(hello), serverAddress);
+}
+
+void NetClient::sendInput(Uint8 keys)
+{
+    if (clientId < 0)
+    {
+        return;
+    }
+
+    Uint8 packet[11];
+    packet[0] = NET_INPUT;
+    packet[1] = (Uint8)clientId;
+    writeU32(packet + 2, ++inputTick);
+    writeU32(packet + 6, latestTick); // doubles as the ack for delta baselines
+    packet[10] = keys;
+    link.send(socketFd, packet, sizeof(packet), serverAddress);
+}
+
+void NetClient::receive()
+{
+    Uint8 packet[NET_PACKET_SIZE];
+
+    while (1)
+    {
+        int size = recv(socketFd, packet, sizeof(packet), 0);
+        if (size <= 0)
+        {
+            return;
+        }
+
+        if (packet[0] == NET_WELCOME && size >= 2)
+        {
+            clientId = packet[1];
+        }
+        else if (packet[0] == NET_SNAPSHOT && size >= 13)
+        {
+            bytesReceived += size;
+            snapshotsReceived++;
+            if (!decodeSnapshot(packet, size))
+            {
+                snapshotsUndecodable++;
+            }
+        }
+    }
+}
+
+bool NetClient::decodeSnapshot(const Uint8 *packet, int size)
+{
+    Uint32 tick = readU32(packet + 1);
+    Uint32 baseTick = readU32(packet + 5);
+    int records = readU16(packet + 11);
+
+    if (tick <= latestTick)
+    {
+        return 1; // late duplicate of something newer, nothing to do
+    }
+
+    NetWorldState state;
+    if (baseTick)
+    {
+        const NetWorldState *base = this->state(baseTick);
+        if (!base)
+        {
+            return 0;
+        }
+        state = *base;
+    }
+    else
+    {
+        state.clear();
+    }
+    state.tick = tick;
+
+    BitReader reader(packet, size, 13);
+    for (int r = 0; r < records; r++)
+    {
+        int id = reader.read(8);
+        NetEntityState &entity = state.entities[id];
+
+        if (reader.read(1))
+        {
+            memset(&entity, 0, sizeof(entity));
+            continue;
+        }
+
+        int mask = reader.read(3);
+        if (mask & 1)
+        {
+            entity.x = reader.read(13);
+            entity.y = reader.read(13);
+        }
+        if (mask & 2)
+        {
+            entity.angle = reader.read(8);
+        }
+        if (mask & 4)
+        {
+            entity.kind = reader.read(2);
+            entity.size = reader.read(6);
+        }
+        entity.alive = 1;
+    }
+
+    if (reader.overflow)
+    {
+        return 0;
+    }
+
+    history[tick % NET_HISTORY] = state;
+    latestTick = tick;
+    return 1;
+}
+
+const NetWorldState *NetClient::state(Uint32 tick)
+{
+    const NetWorldState &state = history[tick % NET_HISTORY];
+    return (tick && state.tick == tick) ? &state : nullptr;
+}
+
+void NetClient::stop()
+{
+    if (socketFd >= 0)
+    {
+        close(socketFd);
+        socketFd = -1;
+    }
+}
+
+NetClient::~NetClient()
+{
+    stop();
+}
+
+// ---------------------------------------------------------------------------
+
+static void reportServer(NetServer &server, float seconds)
+{
+    int connected = 0;
+    Uint64 bytes = 0;
+    int snapshots = 0, fullSnapshots = 0;
+    for (int i = 0; i < NET_MAX_CLIENTS; i++)
+    {
+        if (server.clients[i].connected)
+        {
+            connected++;
+            bytes += server.clients[i].bytesSent;
+            snapshots += server.clients[i].snapshotsSent;
+            fullSnapshots += server.clients[i].fullSnapshotsSent;
+        }
+    }
+
+    double tickUs = server.ticksRun ? server.tickCounterTotal * 1000000.0 / SDL_GetPerformanceFrequency() / server.ticksRun : 0;
+
+    std::cout << "server: " << server.ticksRun / seconds << " ticks/s, " << tickUs << " us per tick"
+              << " (capacity about " << (tickUs > 0 ? (int)(1000000.0 / tickUs) : 0) << " ticks/s)" << std::endl;
+    if (connected)
+    {
+        // 28 bytes of IP + UDP header per datagram on top of the payload
+        double payload = bytes / seconds / connected;
+        double wire = (bytes + snapshots * 28.0) / seconds / connected;
+        std::cout << "  " << connected << " clients, per client " << payload * 8 / 1000 << " kbit/s payload, "
+                  << wire * 8 / 1000 << " kbit/s on the wire, "
+                  << (snapshots ? (float)bytes / snapshots : 0) << " bytes per snapshot, "
+                  << fullSnapshots << " full snapshots" << std::endl;
+    }
+}
+
+int runNetServer(int port, int latencyMs, int lossPercent)
+{
+    SDL_Init(SDL_INIT_TIMER);
+
+    NetServer server;
+    server.link.latencyMs = latencyMs;
+    server.link.lossPercent = lossPercent;
+    if (!server.start(port))
+    {
+        return 1;
+    }
+    std::cout << "server listening on port " << server.boundPort() << std::endl;
+
+    Uint32 nextTick = SDL_GetTicks();
+    Uint32 reportAt = nextTick + 5000;
+    int tickIndex = 0;
+    while (1)
+    {
+        server.receive();
+
+        Uint32 now = SDL_GetTicks();
+        if ((Sint32)(now - nextTick) >= 0)
+        {
+            server.step();
+            server.sendSnapshots();
+            tickIndex++;
+            nextTick += (tickIndex % 3) ? 17 : 16; // 60 Hz on average
+        }
+        server.link.flush(server.socketFd);
+
+        if ((Sint32)(now - reportAt) >= 0)
+        {
+            reportServer(server, 5.0f);
+            for (int i = 0; i < NET_MAX_CLIENTS; i++)
+            {
+                server.clients[i].bytesSent = 0;
+                server.clients[i].snapshotsSent = 0;
+                server.clients[i].fullSnapshotsSent = 0;
+            }
+            server.tickCounterTotal = 0;
+            server.ticksRun = 0;
+            reportAt += 5000;
+        }
+
+        SDL_Delay(1);
+    }
+    return 0;
+}
+
+int runLoopbackTest(int clientsCount, int seconds, int latencyMs, int lossPercent)
+{
+    SDL_Init(SDL_INIT_TIMER);
+
+    clientsCount = std::max(1, std::min(NET_MAX_CLIENTS, clientsCount));
+
+    NetServer server;
+    server.link.latencyMs = latencyMs / 2; // half each way
+    server.link.jitterMs = latencyMs / 10;
+    server.link.lossPercent = lossPercent;
+    if (!server.start(0))
+    {
+        return 1;
+    }
+
+    std::vector<NetClient> clients(clientsCount);
+    std::vector<Uint8> keys(clientsCount, 0);
+    std::vector<Uint32> checkedTick(clientsCount, 0);
+    for (int i = 0; i < clientsCount; i++)
+    {
+        clients[i].link = server.link;
+        if (!clients[i].connect("127.0.0.1", server.boundPort()))
+        {
+            return 1;
+        }
+    }
+
+    int checked = 0, mismatches = 0;
+    int tickIndex = 0;
+    Uint32 start = SDL_GetTicks();
+    Uint32 nextTick = start;
+
+    while (SDL_GetTicks() - start < (Uint32)seconds * 1000)
+    {
+        server.receive();
+
+        if ((Sint32)(SDL_GetTicks() - nextTick) >= 0)
+        {
+            server.step();
+            server.sendSnapshots();
+            tickIndex++;
+            nextTick += (tickIndex % 3) ? 17 : 16;
+
+            for (int i = 0; i < clientsCount; i++)
+            {
+                if (clients[i].clientId < 0)
+                {
+                    if (tickIndex % 10 == 0)
+                    {
+                        clients[i].sendHello();
+                    }
+                    continue;
+                }
+
+                // scripted bots: hold a random key combination for half a second
+                if (tickIndex % 30 == 0)
+                {
+                    keys[i] = rand() % 16;
+                }
+                clients[i].sendInput(keys[i]);
+            }
+        }
+        server.link.flush(server.socketFd);
+
+        for (int i = 0; i < clientsCount; i++)
+        {
+            clients[i].receive();
+            clients[i].link.flush(clients[i].socketFd);
+
+            // the reconstructed state must match what the server quantized for that tick
+            Uint32 tick = clients[i].latestTick;
+            if (tick && tick != checkedTick[i] && server.tick - tick < NET_HISTORY)
+            {
+                const NetWorldState &truth = server.history[tick % NET_HISTORY];
+                if (memcmp(truth.entities, clients[i].state(tick)->entities, sizeof(truth.entities)))
+                {
+                    mismatches++;
+                }
+                checked++;
+                checkedTick[i] = tick;
+            }
+        }
+
+        SDL_Delay(1);
+    }
+
+    float elapsed = (SDL_GetTicks() - start) / 1000.0f;
+
+    std::cout << "loopback: " << clientsCount << " clients, " << seconds << " s, "
+              << latencyMs << " ms latency, " << lossPercent << "% loss" << std::endl;
+    reportServer(server, elapsed);
+
+    int received = 0, undecodable = 0;
+    for (int i = 0; i < clientsCount; i++)
+    {
+        received += clients[i].snapshotsReceived;
+        undecodable += clients[i].snapshotsUndecodable;
+    }
+    std::cout << "  clients received " << received << " snapshots, " << undecodable << " without baseline, "
+              << checked << " states checked, " << mismatches << " mismatches" << std::endl;
+
+    return mismatches ? 1 : 0;
+}
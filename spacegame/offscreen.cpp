@@ -0,0 +1,199 @@
+
+#include <iostream>
+#include <cstdio>
+#include <algorithm>
+#include "include/offscreen.hpp"
+
+OffscreenTarget::OffscreenTarget()
+{
+    width = 0;
+    height = 0;
+    framebuffer = 0;
+    colorBuffer = 0;
+    hasTimerQuery = 0;
+    queriesIssued = 0;
+    queriesRead = 0;
+    frameStart = 0;
+    for (int i = 0; i < QUERY_RING; i++)
+    {
+        timerQueries[i] = 0;
+    }
+}
+
+bool OffscreenTarget::create(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+
+    if (!GLEW_ARB_framebuffer_object)
+    {
+        std::cout << "offscreen: framebuffer objects not supported" << std::endl;
+        return 0;
+    }
+
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "offscreen: framebuffer incomplete" << std::endl;
+        destroy();
+        return 0;
+    }
+
+    // GPU timings are optional, llvmpipe and most desktop drivers expose them
+    hasTimerQuery = GLEW_ARB_timer_query;
+    if (hasTimerQuery)
+    {
+        glGenQueries(QUERY_RING, timerQueries);
+    }
+
+    bind();
+    return 1;
+}
+
+void OffscreenTarget::bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, width, height);
+}
+
+void OffscreenTarget::beginFrame()
+{
+    if (hasTimerQuery)
+    {
+        // only reuse a query slot once its previous result has been read
+        if (queriesIssued - queriesRead >= QUERY_RING)
+        {
+            collectQuery();
+        }
+        glBeginQuery(GL_TIME_ELAPSED, timerQueries[queriesIssued % QUERY_RING]);
+    }
+    frameStart = SDL_GetPerformanceCounter();
+}
+
+void OffscreenTarget::endFrame()
+{
+    Uint64 frameEnd = SDL_GetPerformanceCounter();
+    cpuTimes.push_back((float)((frameEnd - frameStart) * 1000.0 / SDL_GetPerformanceFrequency()));
+
+    if (hasTimerQuery)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        queriesIssued++;
+
+        while (queriesRead < queriesIssued)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(timerQueries[queriesRead % QUERY_RING], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                break;
+            }
+            collectQuery();
+        }
+    }
+}
+
+void OffscreenTarget::collectQuery()
+{
+    // GL_QUERY_RESULT blocks until the result is there
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(timerQueries[queriesRead % QUERY_RING], GL_QUERY_RESULT, &elapsed);
+    gpuTimes.push_back((float)(elapsed / 1000000.0));
+    queriesRead++;
+}
+
+void OffscreenTarget::finish()
+{
+    glFinish();
+    while (hasTimerQuery && queriesRead < queriesIssued)
+    {
+        collectQuery();
+    }
+}
+
+bool OffscreenTarget::dumpPpm(const char *filename)
+{
+    std::vector<unsigned char> pixels(width * height * 3);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+    FILE *file = fopen(filename, "wb");
+    if (!file)
+    {
+        std::cout << "offscreen: cannot write " << filename << std::endl;
+        return 0;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+    // GL rows start at the bottom, PPM rows at the top
+    for (int y = height - 1; y >= 0; y--)
+    {
+        fwrite(&pixels[y * width * 3], 1, width * 3, file);
+    }
+
+    fclose(file);
+    return 1;
+}
+
+void OffscreenTarget::reportTimes(const char *label, std::vector<float> &times)
+{
+    if (times.empty())
+    {
+        std::cout << "  " << label << ": n/a" << std::endl;
+        return;
+    }
+
+    std::vector<float> sorted(times);
+    std::sort(sorted.begin(), sorted.end());
+
+    double total = 0;
+    for (size_t i = 0; i < sorted.size(); i++)
+    {
+        total += sorted[i];
+    }
+
+    std::cout << "  " << label << " ms: avg " << total / sorted.size()
+              << ", p50 " << sorted[sorted.size() / 2]
+              << ", p95 " << sorted[sorted.size() * 95 / 100]
+              << ", max " << sorted.back() << std::endl;
+}
+
+void OffscreenTarget::report(const char *name)
+{
+    std::cout << name << ": " << cpuTimes.size() << " offscreen frames at " << width << "x" << height << std::endl;
+    reportTimes("cpu", cpuTimes);
+    reportTimes("gpu", gpuTimes);
+}
+
+void OffscreenTarget::destroy()
+{
+    if (hasTimerQuery)
+    {
+        glDeleteQueries(QUERY_RING, timerQueries);
+        hasTimerQuery = 0;
+    }
+    if (framebuffer)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer);
+        framebuffer = 0;
+    }
+    if (colorBuffer)
+    {
+        glDeleteRenderbuffers(1, &colorBuffer);
+        colorBuffer = 0;
+    }
+}
+
+OffscreenTarget::~OffscreenTarget()
+{
+}
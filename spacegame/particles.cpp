@@ -0,0 +1,126 @@
+
+#include "include/particles.hpp"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+ParticleSystem::ParticleSystem()
+{
+    for (int i = 0; i < MAX_PARTICLES; i++)
+    {
+        posX[i] = posY[i] = 0.0f;
+        velX[i] = velY[i] = 0.0f;
+        life[i] = 0.0f;
+    }
+    count = 0;
+    setBounds(0.0f, 0.0f, 800.0f, 600.0f);
+}
+
+void ParticleSystem::setBounds(float minX, float minY, float maxX, float maxY)
+{
+    this->minX = minX;
+    this->minY = minY;
+    this->maxX = maxX;
+    this->maxY = maxY;
+}
+
+bool ParticleSystem::emit(float x, float y, float vx, float vy, float lifetime)
+{
+    if (count >= MAX_PARTICLES)
+    {
+        return 0;
+    }
+
+    posX[count] = x;
+    posY[count] = y;
+    velX[count] = vx;
+    velY[count] = vy;
+    life[count] = lifetime;
+    count++;
+    return 1;
+}
+
+void ParticleSystem::update()
+{
+    // integrate, 4 particles at a time; lanes past count are padding and never read back
+    int n = (count + 3) & ~3;
+
+#if defined(__SSE__)
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (int i = 0; i < n; i += 4)
+    {
+        _mm_store_ps(&posX[i], _mm_add_ps(_mm_load_ps(&posX[i]), _mm_load_ps(&velX[i])));
+        _mm_store_ps(&posY[i], _mm_add_ps(_mm_load_ps(&posY[i]), _mm_load_ps(&velY[i])));
+        _mm_store_ps(&life[i], _mm_sub_ps(_mm_load_ps(&life[i]), one));
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    for (int i = 0; i < n; i += 4)
+    {
+        vst1q_f32(&posX[i], vaddq_f32(vld1q_f32(&posX[i]), vld1q_f32(&velX[i])));
+        vst1q_f32(&posY[i], vaddq_f32(vld1q_f32(&posY[i]), vld1q_f32(&velY[i])));
+        vst1q_f32(&life[i], vsubq_f32(vld1q_f32(&life[i]), one));
+    }
+#else
+    for (int i = 0; i < n; i++)
+    {
+        posX[i] += velX[i];
+        posY[i] += velY[i];
+        life[i] -= 1.0f;
+    }
+#endif
+
+    // expire: move the last live particle into the dead slot so the arrays stay packed
+    int i = 0;
+    while (i < count)
+    {
+        if (life[i] <= 0.0f ||
+            posX[i] < minX || posX[i] > maxX ||
+            posY[i] < minY || posY[i] > maxY)
+        {
+            count--;
+            posX[i] = posX[count];
+            posY[i] = posY[count];
+            velX[i] = velX[count];
+            velY[i] = velY[count];
+            life[i] = life[count];
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+void ParticleSystem::render(float pointSize)
+{
+    if (!count)
+    {
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        vertices[i * 2] = posX[i];
+        vertices[i * 2 + 1] = posY[i];
+    }
+
+    glPointSize(pointSize);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, vertices);
+    glDrawArrays(GL_POINTS, 0, count);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void ParticleSystem::clear()
+{
+    count = 0;
+}
+
+ParticleSystem::~ParticleSystem()
+{
+}
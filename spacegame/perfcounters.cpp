@@ -0,0 +1,213 @@
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include "include/perfcounters.hpp"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+static const char *phaseNames[PerfCounters::PHASES] = {"wait", "events", "move", "bounds", "collide", "cleanup", "render", "swap"};
+
+PerfCounters::PerfCounters()
+{
+    isEnabled = 0;
+    hasCounters = 0;
+    wasMultiplexed = 0;
+    groupFd = -1;
+    current = WAIT;
+    phaseStart = 0;
+    for (int c = 0; c < COUNTERS; c++)
+    {
+        fds[c] = -1;
+        slotOf[c] = -1;
+        lastValues[c] = 0;
+    }
+    for (int p = 0; p < PHASES; p++)
+    {
+        times[p] = 0;
+        for (int c = 0; c < COUNTERS; c++)
+        {
+            counts[p][c] = 0;
+        }
+    }
+}
+
+void PerfCounters::start()
+{
+#ifdef __linux__
+    static const Uint64 configs[COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                             PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+    int opened = 0;
+    int firstError = 0;
+    for (int c = 0; c < COUNTERS; c++)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[c];
+        attr.disabled = groupFd < 0; // the leader starts the whole group
+        attr.exclude_kernel = 1;     // allowed at the default perf_event_paranoid
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+        if (fd < 0)
+        {
+            firstError = firstError ? firstError : errno;
+            continue;
+        }
+        fds[c] = fd;
+        slotOf[c] = opened++;
+        if (groupFd < 0)
+        {
+            groupFd = fd;
+        }
+    }
+
+    if (opened)
+    {
+        ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        hasCounters = 1;
+        if (opened < COUNTERS)
+        {
+            std::cout << "perf: " << COUNTERS - opened << " counters unavailable (" << strerror(firstError) << ")" << std::endl;
+        }
+    }
+    else
+    {
+        std::cout << "perf: hardware counters unavailable (" << strerror(firstError) << "), timing phases only" << std::endl;
+        if (firstError == EACCES || firstError == EPERM)
+        {
+            std::cout << "perf: lower /proc/sys/kernel/perf_event_paranoid to 2 or below to allow them" << std::endl;
+        }
+    }
+#else
+    std::cout << "perf: hardware counters need Linux, timing phases only" << std::endl;
+#endif
+
+    if (hasCounters)
+    {
+        readGroup(lastValues);
+    }
+    current = WAIT;
+    phaseStart = SDL_GetPerformanceCounter();
+    isEnabled = 1;
+}
+
+bool PerfCounters::readGroup(Uint64 *values)
+{
+#ifdef __linux__
+    // nr, time enabled, time running, then one value per opened counter
+    Uint64 buffer[3 + COUNTERS];
+    if (read(groupFd, buffer, sizeof(buffer)) <= 0)
+    {
+        return 0;
+    }
+
+    if (buffer[2] < buffer[1])
+    {
+        wasMultiplexed = 1;
+    }
+    for (int c = 0; c < COUNTERS; c++)
+    {
+        values[c] = slotOf[c] >= 0 ? buffer[3 + slotOf[c]] : 0;
+    }
+    return 1;
+#else
+    (void)values;
+    return 0;
+#endif
+}
+
+void PerfCounters::switchPhase(int phase)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    times[current] += now - phaseStart;
+    phaseStart = now;
+
+    Uint64 values[COUNTERS];
+    if (hasCounters && readGroup(values))
+    {
+        for (int c = 0; c < COUNTERS; c++)
+        {
+            counts[current][c] += values[c] - lastValues[c];
+            lastValues[c] = values[c];
+        }
+    }
+
+    current = phase;
+}
+
+void PerfCounters::report(int frames)
+{
+    if (!isEnabled || frames <= 0)
+    {
+        return;
+    }
+    enter(WAIT); // close the phase that is still open
+
+    double msPerCount = 1000.0 / SDL_GetPerformanceFrequency();
+
+    std::cout << "perf: per phase over " << frames << " frames" << (hasCounters ? ", user space counters" : "") << std::endl;
+    if (hasCounters)
+    {
+        std::cout << "  phase       ms/frame    IPC  cache miss/kinstr  branch miss/kinstr" << std::endl;
+    }
+    else
+    {
+        std::cout << "  phase       ms/frame" << std::endl;
+    }
+
+    for (int p = 0; p < PHASES; p++)
+    {
+        char line[128];
+        int length = snprintf(line, sizeof(line), "  %-9s %10.4f", phaseNames[p], times[p] * msPerCount / frames);
+
+        Uint64 *count = counts[p];
+        if (hasCounters && count[INSTRUCTIONS])
+        {
+            double kiloInstructions = count[INSTRUCTIONS] / 1000.0;
+            snprintf(line + length, sizeof(line) - length, " %6.2f %18.2f %19.2f",
+                     slotOf[CYCLES] >= 0 && count[CYCLES] ? (double)count[INSTRUCTIONS] / count[CYCLES] : 0.0,
+                     count[CACHE_MISSES] / kiloInstructions, count[BRANCH_MISSES] / kiloInstructions);
+        }
+        std::cout << line << std::endl;
+    }
+
+    if (wasMultiplexed)
+    {
+        std::cout << "  counters were multiplexed with other users, counts cover part of the run" << std::endl;
+    }
+}
+
+void PerfCounters::stop()
+{
+#ifdef __linux__
+    for (int c = 0; c < COUNTERS; c++)
+    {
+        if (fds[c] >= 0)
+        {
+            close(fds[c]);
+            fds[c] = -1;
+        }
+        slotOf[c] = -1;
+    }
+#endif
+    groupFd = -1;
+    hasCounters = 0;
+    isEnabled = 0;
+}
+
+PerfCounters::~PerfCounters()
+{
+    stop();
+}
@@ -0,0 +1,522 @@
+
+#include <iostream>
+#include <algorithm>
+#include <math.h>
+#include "include/worlds.hpp"
+
+static float deg2rad(float deg)
+{
+    return deg * M_PI / 180.0f;
+}
+
+WorldBatch::WorldBatch()
+{
+    count = 0;
+    episodesFinished = 0;
+    pendingActions = nullptr;
+    generation = 0;
+    busyWorkers = 0;
+    chunks = 1;
+    stopping = 0;
+}
+
+void WorldBatch::create(int worlds, unsigned int seed, int threadsCount)
+{
+    destroy();
+
+    count = std::max(1, worlds);
+
+    shipX.assign(count, 0);
+    shipY.assign(count, 0);
+    shipAngle.assign(count, 0);
+    shipVelX.assign(count, 0);
+    shipVelY.assign(count, 0);
+    shipThrottle.assign(count, 0);
+    shipRotation.assign(count, 0);
+
+    bulletX.assign(count, 0);
+    bulletY.assign(count, 0);
+    bulletVelX.assign(count, 0);
+    bulletVelY.assign(count, 0);
+    bulletAlive.assign(count, 0);
+
+    asteroidX.assign(count * WORLD_ASTEROIDS, 0);
+    asteroidY.assign(count * WORLD_ASTEROIDS, 0);
+    asteroidVelX.assign(count * WORLD_ASTEROIDS, 0);
+    asteroidVelY.assign(count * WORLD_ASTEROIDS, 0);
+    asteroidSize.assign(count * WORLD_ASTEROIDS, 0);
+    asteroidAlive.assign(count * WORLD_ASTEROIDS, 0);
+
+    score.assign(count, 0);
+    level.assign(count, 1);
+    shield.assign(count, 3);
+    rng.assign(count, GameRandom());
+
+    observations.assign(count * WORLD_OBS_SIZE, 0);
+    rewards.assign(count, 0);
+    done.assign(count, 0);
+    lastEpisodeScore.assign(count, 0);
+    episodesFinished = 0;
+
+    for (int world = 0; world < count; world++)
+    {
+        // distinct, never zero streams per world
+        rng[world].seed(seed * 2654435761u + world + 1);
+        reset(world);
+        observe(world);
+    }
+
+    // the calling thread always takes the first chunk itself
+    threadsCount = std::max(1, std::min(threadsCount, count));
+    chunks = threadsCount;
+    generation = 0;
+    stopping = 0;
+    for (int i = 1; i < threadsCount; i++)
+    {
+        workers.push_back(std::thread(&WorldBatch::workerLoop, this, i));
+    }
+}
+
+void WorldBatch::reset(int world)
+{
+    shipX[world] = 400.0f;
+    shipY[world] = 300.0f;
+    shipAngle[world] = 0.0f;
+    shipVelX[world] = 0.0f;
+    shipVelY[world] = 0.0f;
+    shipThrottle[world] = 0.0f;
+    shipRotation[world] = 0.0f;
+
+    bulletAlive[world] = 0;
+
+    for (int slot = 0; slot < WORLD_ASTEROIDS; slot++)
+    {
+        asteroidAlive[world * WORLD_ASTEROIDS + slot] = 0;
+    }
+
+    score[world] = 0;
+    level[world] = 1;
+    shield[world] = 3;
+
+    spawnAsteroid(world, 0);
+}
+
+void WorldBatch::spawnAsteroid(int world, int slot)
+{
+    static const float sizes[4] = {15, 20, 25, 30};
+
+    GameRandom &random = rng[world];
+    int i = world * WORLD_ASTEROIDS + slot;
+    float size = sizes[random.next() % 4];
+
+    asteroidAlive[i] = 1;
+    asteroidSize[i] = size;
+
+    switch (random.next() % 4)
+    {
+    case 0: // top
+        asteroidX[i] = (float)(random.next() % 800);
+        asteroidY[i] = 600 + size;
+        asteroidVelX[i] = ((float)(random.next() % 300)) / 100.0f;
+        asteroidVelY[i] = -1 * ((float)(random.next() % 300)) / 100.0f;
+        break;
+    case 1: // left
+        asteroidX[i] = -1 * size;
+        asteroidY[i] = (float)(random.next() % 600);
+        asteroidVelX[i] = ((float)(random.next() % 300)) / 100.0f;
+        asteroidVelY[i] = ((float)(random.next() % 300)) / 100.0f;
+        break;
+    case 2: // right
+        asteroidX[i] = 800 + size;
+        asteroidY[i] = (float)(random.next() % 600);
+        asteroidVelX[i] = -1 * ((float)(random.next() % 300)) / 100.0f;
+        asteroidVelY[i] = -1 * ((float)(random.next() % 300)) / 100.0f;
+        break;
+    default: // bottom
+        asteroidX[i] = (float)(random.next() % 800);
+        asteroidY[i] = -1 * size;
+        asteroidVelX[i] = ((float)(random.next() % 300)) / 100.0f;
+        asteroidVelY[i] = ((float)(random.next() % 300)) / 100.0f;
+        break;
+    }
+}
+
+void WorldBatch::spawnMoreAsteroids(int world)
+{
+    int alive = 0;
+    for (int slot = 0; slot < WORLD_ASTEROIDS; slot++)
+    {
+        alive += asteroidAlive[world * WORLD_ASTEROIDS + slot];
+    }
+
+    int maxAsteroidsCount = 1;
+    if (score[world] <= 3)
+    {
+        maxAsteroidsCount = 1;
+        level[world] = 1;
+    }
+    else if (score[world] <= 6)
+    {
+        maxAsteroidsCount = 2;
+        level[world] = 2;
+    }
+    else if (score[world] <= 10)
+    {
+        maxAsteroidsCount = 4;
+        level[world] = 3;
+    }
+    else
+    {
+        maxAsteroidsCount = 6;
+        level[world] = 4;
+    }
+
+    for (int slot = 0; slot < WORLD_ASTEROIDS && alive < maxAsteroidsCount; slot++)
+    {
+        if (!asteroidAlive[world * WORLD_ASTEROIDS + slot])
+        {
+            spawnAsteroid(world, slot);
+            alive++;
+        }
+    }
+}
+
+void WorldBatch::observe(int world)
+{
+    float *out = &observations[world * WORLD_OBS_SIZE];
+
+    out[0] = shipX[world] / 800.0f;
+    out[1] = shipY[world] / 600.0f;
+    out[2] = cos(deg2rad(shipAngle[world]));
+    out[3] = sin(deg2rad(shipAngle[world]));
+    out[4] = shipVelX[world] / 3.0f;
+    out[5] = shipVelY[world] / 3.0f;
+    out[6] = bulletAlive[world];
+    out += 7;
+
+    // asteroids relative to the ship, dead slots all zero
+    for (int slot = 0; slot < WORLD_ASTEROIDS; slot++, out += 6)
+    {
+        int i = world * WORLD_ASTEROIDS + slot;
+        bool alive = asteroidAlive[i];
+        out[0] = alive ? (asteroidX[i] - shipX[world]) / 800.0f : 0;
+        out[1] = alive ? (asteroidY[i] - shipY[world]) / 600.0f : 0;
+        out[2] = alive ? asteroidVelX[i] / 3.0f : 0;
+        out[3] = alive ? asteroidVelY[i] / 3.0f : 0;
+        out[4] = alive ? asteroidSize[i] / 30.0f : 0;
+        out[5] = alive;
+    }
+}
+
+void WorldBatch::stepRange(const Uint8 *actions, int begin, int end)
+{
+    static const float forceFactor = 0.02f;
+    static const float maxMainThrottle = 5.0f;
+    static const float maxRotationThrottle = 3.0f;
+
+    // ships and bullets
+
+    for (int w = begin; w < end; w++)
+    {
+        Uint8 keys = actions[w];
+        float forX = 0, forY = 0;
+
+        if (keys & WORLD_THRUST)
+        {
+            if (shipThrottle[w] < maxMainThrottle)
+            {
+                shipThrottle[w] += 0.5;
+            }
+            forX = shipThrottle[w] * cos(deg2rad(shipAngle[w]));
+            forY = shipThrottle[w] * sin(deg2rad(shipAngle[w]));
+        }
+
+        if (keys & (WORLD_LEFT | WORLD_RIGHT))
+        {
+            if (shipRotation[w] < maxRotationThrottle)
+            {
+                shipRotation[w] += 0.05;
+            }
+            shipAngle[w] += (keys & WORLD_LEFT) ? shipRotation[w] : -shipRotation[w];
+        }
+        else
+        {
+            shipThrottle[w] = shipThrottle[w] > 0.2f ? shipThrottle[w] - 0.2f : 0;
+            shipRotation[w] = shipRotation[w] > 0.1f ? shipRotation[w] - 0.1f : 0;
+        }
+
+        shipVelX[w] = std::max(-3.0f, std::min(3.0f, shipVelX[w] + forX * forceFactor));
+        shipVelY[w] = std::max(-3.0f, std::min(3.0f, shipVelY[w] + forY * forceFactor));
+        shipX[w] += shipVelX[w];
+        shipY[w] += shipVelY[w];
+
+        if ((keys & WORLD_FIRE) && !bulletAlive[w])
+        {
+            bulletAlive[w] = 1;
+            bulletX[w] = shipX[w];
+            bulletY[w] = shipY[w];
+            bulletVelX[w] = 10.0f * cos(deg2rad(shipAngle[w]));
+            bulletVelY[w] = 10.0f * sin(deg2rad(shipAngle[w]));
+        }
+
+        if (bulletAlive[w])
+        {
+            bulletX[w] += bulletVelX[w];
+            bulletY[w] += bulletVelY[w];
+            if (bulletX[w] > 800.0f || bulletX[w] < 0.0f || bulletY[w] > 600.0f || bulletY[w] < 0.0f)
+            {
+                bulletAlive[w] = 0;
+            }
+        }
+
+        if (shipX[w] > 800.0f)
+        {
+            shipX[w] = 0;
+        }
+        if (shipX[w] < 0.0f)
+        {
+            shipX[w] = 800;
+        }
+        if (shipY[w] > 600.0f)
+        {
+            shipY[w] = 0;
+        }
+        if (shipY[w] < 0.0f)
+        {
+            shipY[w] = 600.0f;
+        }
+    }
+
+    // asteroids, dead slots move too so the loop has no branches on liveness
+
+    for (int i = begin * WORLD_ASTEROIDS; i < end * WORLD_ASTEROIDS; i++)
+    {
+        float x = asteroidX[i] + asteroidVelX[i];
+        float y = asteroidY[i] + asteroidVelY[i];
+        float size = asteroidSize[i];
+
+        x = (x > 800.0f && asteroidVelX[i] > 0) ? 0 : x;
+        x = (x < -size && asteroidVelX[i] < 0) ? 800 : x;
+        y = (y > 600.0f - size && asteroidVelY[i] > 0) ? 0 : y;
+        y = (y < -size && asteroidVelY[i] < 0) ? 600 : y;
+
+        asteroidX[i] = x;
+        asteroidY[i] = y;
+    }
+
+    // collisions, scoring and episode ends
+
+    for (int w = begin; w < end; w++)
+    {
+        float reward = 0;
+        bool anyDestroyed = 0;
+        bool gameOver = 0;
+
+        for (int slot = 0; slot < WORLD_ASTEROIDS; slot++)
+        {
+            int i = w * WORLD_ASTEROIDS + slot;
+            if (!asteroidAlive[i])
+            {
+                continue;
+            }
+
+            // bullets have no size, a hit is the bullet inside the asteroid box
+            if (bulletAlive[w] &&
+                bulletX[w] >= asteroidX[i] - asteroidSize[i] && bulletX[w] <= asteroidX[i] + asteroidSize[i] &&
+                bulletY[w] >= asteroidY[i] - asteroidSize[i] && bulletY[w] <= asteroidY[i] + asteroidSize[i])
+            {
+                score[w]++;
+                reward += 1;
+                bulletAlive[w] = 0;
+                asteroidAlive[i] = 0;
+                anyDestroyed = 1;
+                continue;
+            }
+
+            static const float shipSize = 20.0f;
+            if (shipX[w] + shipSize >= asteroidX[i] - asteroidSize[i] && shipX[w] - shipSize <= asteroidX[i] + asteroidSize[i] &&
+                shipY[w] + shipSize >= asteroidY[i] - asteroidSize[i] && shipY[w] - shipSize <= asteroidY[i] + asteroidSize[i])
+            {
+                asteroidAlive[i] = 0;
+                anyDestroyed = 1;
+                shield[w] = asteroidSize[i] < 20 ? shield[w] - 1 : 0;
+                if (shield[w] <= 0)
+                {
+                    gameOver = 1;
+                    break;
+                }
+            }
+        }
+
+        if (gameOver)
+        {
+            reward -= 1;
+            lastEpisodeScore[w] = score[w];
+            reset(w);
+        }
+        else if (anyDestroyed)
+        {
+            spawnMoreAsteroids(w);
+        }
+
+        rewards[w] = reward;
+        done[w] = gameOver;
+        observe(w);
+    }
+}
+
+void WorldBatch::step(const std::vector<Uint8> &actions)
+{
+    if ((int)actions.size() != count)
+    {
+        std::cout << "WorldBatch::step: got " << actions.size() << " actions for " << count << " worlds" << std::endl;
+        return;
+    }
+
+    if (!workers.empty())
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingActions = actions.data();
+        busyWorkers = (int)workers.size();
+        generation++;
+        wakeUp.notify_all();
+    }
+
+    stepRange(actions.data(), 0, count / chunks);
+
+    if (!workers.empty())
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (busyWorkers)
+        {
+            finished.wait(lock);
+        }
+    }
+
+    for (int w = 0; w < count; w++)
+    {
+        episodesFinished += done[w];
+    }
+}
+
+void WorldBatch::workerLoop(int index)
+{
+    Uint32 seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (1)
+    {
+        while (generation == seen && !stopping)
+        {
+            wakeUp.wait(lock);
+        }
+        if (stopping)
+        {
+            return;
+        }
+        seen = generation;
+
+        const Uint8 *actions = pendingActions;
+        int begin = (int)((Sint64)count * index / chunks);
+        int end = (int)((Sint64)count * (index + 1) / chunks);
+
+        lock.unlock();
+        stepRange(actions, begin, end);
+        lock.lock();
+
+        if (--busyWorkers == 0)
+        {
+            finished.notify_one();
+        }
+    }
+}
+
+void WorldBatch::destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = 1;
+        wakeUp.notify_all();
+    }
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+    workers.clear();
+}
+
+WorldBatch::~WorldBatch()
+{
+    destroy();
+}
+
+// ---------------------------------------------------------------------------
+
+static void randomActions(GameRandom &agent, std::vector<Uint8> &actions)
+{
+    for (size_t i = 0; i < actions.size(); i++)
+    {
+        int roll = agent.next();
+        Uint8 keys = 0;
+        keys |= (roll & 1) ? WORLD_THRUST : 0;
+        keys |= ((roll >> 1) & 3) == 1 ? WORLD_LEFT : (((roll >> 1) & 3) == 2 ? WORLD_RIGHT : 0);
+        keys |= ((roll >> 3) & 3) == 0 ? WORLD_FIRE : 0;
+        actions[i] = keys;
+    }
+}
+
+static std::vector<float> runBatch(WorldBatch &batch, int steps, double &seconds)
+{
+    GameRandom agent;
+    std::vector<Uint8> actions(batch.count);
+
+    Uint64 begin = SDL_GetPerformanceCounter();
+    for (int i = 0; i < steps; i++)
+    {
+        randomActions(agent, actions);
+        batch.step(actions);
+    }
+    seconds = (double)(SDL_GetPerformanceCounter() - begin) / SDL_GetPerformanceFrequency();
+
+    return batch.observations;
+}
+
+int runBatchBenchmark(int worlds, int threadsCount, int steps)
+{
+    SDL_Init(SDL_INIT_TIMER);
+
+    threadsCount = std::max(1, threadsCount);
+
+    WorldBatch batch;
+    batch.create(worlds, 1, threadsCount);
+
+    double seconds = 0;
+    std::vector<float> observations = runBatch(batch, steps, seconds);
+
+    double worldSteps = (double)batch.count * steps;
+    double scores = 0;
+    for (int w = 0; w < batch.count; w++)
+    {
+        scores += batch.lastEpisodeScore[w];
+    }
+
+    std::cout << "batch: " << batch.count << " worlds x " << steps << " steps on " << threadsCount << " threads, "
+              << seconds * 1000.0 << " ms" << std::endl;
+    std::cout << "  " << worldSteps / seconds << " world-steps/s, " << worldSteps / seconds / threadsCount
+              << " per thread" << std::endl;
+    std::cout << "  " << batch.episodesFinished << " episodes finished, last score avg "
+              << scores / batch.count << std::endl;
+
+    // splitting the worlds across threads must not change any of them
+    bool matches = 1;
+    if (threadsCount > 1)
+    {
+        WorldBatch reference;
+        reference.create(worlds, 1, 1);
+        double referenceSeconds = 0;
+        matches = runBatch(reference, steps, referenceSeconds) == observations;
+        std::cout << "  single thread: " << worldSteps / referenceSeconds << " world-steps/s, results "
+                  << (matches ? "match" : "DIFFER") << std::endl;
+    }
+
+    return matches ? 0 : 1;
+}